@@ -0,0 +1,252 @@
+#include "BenchReport.h"
+
+#include <ArraySort.h>
+
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+struct SortBenchOptions
+{
+  BenchReport::Format format{ BenchReport::Format::JSON };
+  std::string output{};
+  size_t arraySize{ size_t{ 1 } << 24 };
+  std::vector<ThreadCount> threadCounts{};
+  ArrayDistribution distribution{ ArrayDistribution::UNIFORM };
+  size_t grain{ 0 };
+  size_t repetitionCount{ 5 };
+  uint64_t seed{ 1 };
+  // Arrays are sorted in the file (runs and their merge) if it is given
+  std::string arrayFile{};
+  // Weak scaling keeps the array size per thread, strong scaling keeps the array size
+  bool isWeakScaling{ false };
+  // Every part is generated and sorted by one task (see ArraySort::generateAndSort)
+  bool isFused{ false };
+};
+
+// Order independent checksum of the array values, sorting must not change it
+static uint64_t checksum(const Array& array) noexcept
+{
+  uint64_t sum{ 0 };
+  uint64_t squareSum{ 0 };
+  for (auto value : array)
+  {
+    sum += static_cast<uint64_t>(value);
+    squareSum += static_cast<uint64_t>(value) * static_cast<uint64_t>(value);
+  }
+  return sum ^ (squareSum * 0x9E3779B97F4A7C15ull);
+}
+
+// Every part is sorted and the parts cover the whole array
+static bool verify(const Array& array, std::vector<IndexRange> ranges)
+{
+  std::sort(ranges.begin(), ranges.end());
+  size_t first{ 0 };
+  for (const auto& range : ranges)
+  {
+    if ((range.first != first) || (range.second > array.size()) || !std::is_sorted(array.begin() + range.first, array.begin() + range.second))
+      return false;
+    first = range.second;
+  }
+  return first == array.size();
+}
+
+static bool runThreadCount(BenchReport& report, const SortBenchOptions& options, ThreadCount threadCount, double& baseWork)
+{
+  std::mutex rangesMutex{};
+  std::vector<IndexRange> ranges{};
+  ArraySort arraySort{ [&rangesMutex, &ranges](TaskId, ThreadId, size_t from, size_t to)
+    {
+      std::unique_lock lock{ rangesMutex };
+      ranges.push_back({ from, to });
+    },
+    [](TaskId, const SortTaskResult&) {}, threadCount, options.arrayFile };
+
+  auto arraySize = options.isWeakScaling ? options.arraySize * threadCount : options.arraySize;
+  std::vector<double> generateTimes{};
+  std::vector<double> sortTimes{};
+  std::vector<double> generateFaults{};
+  std::vector<double> sortFaults{};
+  for (size_t repetitionIndex = 0; repetitionIndex < options.repetitionCount; ++repetitionIndex)
+  {
+    // The fused array is the same as the generated one with the same seed
+    if (options.isFused && (repetitionIndex == 0))
+      arraySort.generateArray(arraySize, options.distribution, options.seed);
+    auto expectedChecksum = options.isFused ? checksum(arraySort.array()) : 0;
+    auto startFaultCount = ArraySort::pageFaultCount();
+    auto start = std::chrono::steady_clock::now();
+    if (!options.isFused)
+      arraySort.generateArray(arraySize, options.distribution, options.seed);
+    auto generateFinish = std::chrono::steady_clock::now();
+    auto generateFaultCount = ArraySort::pageFaultCount();
+    if (!options.isFused)
+      expectedChecksum = checksum(arraySort.array());
+    ranges.clear();
+    auto sortFaultCount = ArraySort::pageFaultCount();
+    auto sortStart = std::chrono::steady_clock::now();
+    for (const auto& taskHandle : options.isFused ? arraySort.generateAndSort(arraySize, options.distribution, options.seed, options.grain)
+                                                  : arraySort.sort(options.grain))
+      taskHandle.result.get();
+    // The merge of a file array is queued by the last run
+    while (!arraySort.areAllTasksFinished())
+      std::this_thread::yield();
+    auto finish = std::chrono::steady_clock::now();
+    generateFaults.push_back(double(generateFaultCount - startFaultCount));
+    sortFaults.push_back(double(ArraySort::pageFaultCount() - sortFaultCount));
+    generateTimes.push_back(std::chrono::duration<double>(generateFinish - start).count());
+    sortTimes.push_back(std::chrono::duration<double>(finish - sortStart).count());
+
+    // Merged runs of a file array are sorted as a whole
+    auto isSorted = arraySort.taskCount() > arraySort.partCount() ? std::is_sorted(arraySort.array().begin(), arraySort.array().end())
+                                                                  : verify(arraySort.array(), ranges);
+    // A random seed gives the fused mode another array than the one of the expected checksum
+    if (((checksum(arraySort.array()) != expectedChecksum) && (!options.isFused || options.seed)) || !isSorted)
+    {
+      std::cerr << "Wrong sort result with " << threadCount << " threads" << std::endl;
+      return false;
+    }
+  }
+
+  auto generateTime = BenchReport::median(generateTimes);
+  auto sortTime = BenchReport::median(sortTimes);
+  auto totalTime = generateTime + sortTime;
+  // Efficiency relative to the first thread count: work per thread-second compared to the baseline
+  auto work = arraySize / (totalTime * threadCount);
+  if (baseWork == 0)
+    baseWork = work;
+  if (options.isFused)
+  {
+    report.add({ "arraySort", "generateAndSortTime", threadCount, sortTime, "s" });
+    report.add({ "arraySort", "generateAndSortPageFaults", threadCount, BenchReport::median(sortFaults), "faults" });
+  }
+  else
+  {
+    report.add({ "arraySort", "generateTime", threadCount, generateTime, "s" });
+    report.add({ "arraySort", "sortTime", threadCount, sortTime, "s" });
+    report.add({ "arraySort", "generatePageFaults", threadCount, BenchReport::median(generateFaults), "faults" });
+    report.add({ "arraySort", "sortPageFaults", threadCount, BenchReport::median(sortFaults), "faults" });
+  }
+  report.add({ "arraySort", "wallTime", threadCount, totalTime, "s" });
+  report.add({ "arraySort", "throughput", threadCount, arraySize / totalTime, "elements/s" });
+  report.add({ "arraySort", "efficiency", threadCount, work / baseWork, "ratio" });
+  return true;
+}
+
+static void printUsage()
+{
+  std::cout << "Usage: ArraySortBench [--size N] [--threads N[,N...]] [--distribution uniform|sorted|reversed|fewunique] [--grain N]" << std::endl
+            << "                      [--repetitions N] [--seed N] [--scaling strong|weak] [--mode separate|fused] [--file PATH]" << std::endl
+            << "                      [--format json|csv] [--output FILE]" << std::endl
+            << "The array is split into parts of the grain size (0 is a part per thread), every part is sorted separately." << std::endl
+            << "The fused mode generates every part right before its sort, its grain 0 is a part per 256 KiB." << std::endl
+            << "A file array is memory-mapped, its parts are sorted runs merged into the sorted file." << std::endl
+            << "Weak scaling multiplies the array size by the thread count." << std::endl;
+}
+
+static bool parseOptions(int argc, char* argv[], SortBenchOptions& options)
+{
+  for (int argIndex = 1; argIndex < argc; ++argIndex)
+  {
+    std::string arg{ argv[argIndex] };
+    if ((arg == "--help") || (arg == "-h") || (argIndex + 1 == argc))
+      return false;
+    std::string value{ argv[++argIndex] };
+    if (arg == "--size")
+      options.arraySize = std::stoull(value);
+    else if (arg == "--threads")
+    {
+      std::istringstream stream{ value };
+      std::string threadCount{};
+      while (std::getline(stream, threadCount, ','))
+        options.threadCounts.push_back(std::max<ThreadCount>(std::stoul(threadCount), 1));
+    }
+    else if (arg == "--distribution")
+    {
+      static const std::pair<const char*, ArrayDistribution> distributions[] = { { "uniform", ArrayDistribution::UNIFORM },
+        { "sorted", ArrayDistribution::SORTED }, { "reversed", ArrayDistribution::REVERSED }, { "fewunique", ArrayDistribution::FEW_UNIQUE } };
+      auto distribution = std::find_if(std::begin(distributions), std::end(distributions), [&value](const auto& item) { return value == item.first; });
+      if (distribution == std::end(distributions))
+        return false;
+      options.distribution = distribution->second;
+    }
+    else if (arg == "--grain")
+      options.grain = std::stoull(value);
+    else if (arg == "--repetitions")
+      options.repetitionCount = std::max(std::stoul(value), 1ul);
+    else if (arg == "--seed")
+      options.seed = std::stoull(value);
+    else if ((arg == "--scaling") && ((value == "strong") || (value == "weak")))
+      options.isWeakScaling = value == "weak";
+    else if ((arg == "--mode") && ((value == "separate") || (value == "fused")))
+      options.isFused = value == "fused";
+    else if ((arg == "--format") && ((value == "json") || (value == "csv")))
+      options.format = value == "csv" ? BenchReport::Format::CSV : BenchReport::Format::JSON;
+    else if (arg == "--file")
+      options.arrayFile = value;
+    else if (arg == "--output")
+      options.output = value;
+    else
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  SortBenchOptions options{};
+  try
+  {
+    if (!parseOptions(argc, argv, options))
+    {
+      printUsage();
+      return 1;
+    }
+  }
+  catch (const std::exception&)
+  {
+    printUsage();
+    return 1;
+  }
+  if (options.threadCounts.empty())
+  {
+    auto maxThreadCount = std::max<ThreadCount>(std::thread::hardware_concurrency(), 1);
+    for (ThreadCount threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+      options.threadCounts.push_back(threadCount);
+    options.threadCounts.push_back(maxThreadCount);
+  }
+
+  BenchReport report{ "ArraySortBench", options.format };
+  double baseWork{ 0 };
+  for (auto threadCount : options.threadCounts)
+  {
+    auto arraySize = options.isWeakScaling ? options.arraySize * threadCount : options.arraySize;
+    if (!options.arrayFile.empty() && (arraySize > ArraySort::maxFileArraySize(options.arrayFile)))
+    {
+      std::cerr << "Not enough disk space for " << options.arrayFile << std::endl;
+      return 1;
+    }
+    if (arraySize < ArraySort::minArraySize(threadCount))
+    {
+      std::cerr << "The array is too small for " << threadCount << " threads" << std::endl;
+      return 1;
+    }
+    std::cerr << "Sorting with " << threadCount << " threads..." << std::endl;
+    if (!runThreadCount(report, options, threadCount, baseWork))
+      return 2;
+  }
+
+  if (options.output.empty())
+    report.write(std::cout);
+  else
+  {
+    std::ofstream stream{ options.output };
+    report.write(stream);
+    if (!stream)
+    {
+      std::cerr << "Failed to write " << options.output << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
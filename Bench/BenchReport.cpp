@@ -0,0 +1,55 @@
+#include "BenchReport.h"
+
+#include <iomanip>
+#include <thread>
+
+static std::string escape(const std::string& value)
+{
+  std::string result{};
+  for (auto ch : value)
+  {
+    if ((ch == '"') || (ch == '\\'))
+      result += '\\';
+    result += ch;
+  }
+  return result;
+}
+
+BenchReport::BenchReport(const std::string& name, Format format)
+  : _name{ name }
+  , _format{ format }
+  , _results{}
+{
+}
+
+void BenchReport::add(BenchResult&& result)
+{
+  _results.push_back(std::move(result));
+}
+
+void BenchReport::write(std::ostream& stream) const
+{
+  auto precision = stream.precision(6);
+  if (_format == Format::CSV)
+  {
+    stream << "benchmark,parameter,threads,value,unit" << std::endl;
+    for (const auto& result : _results)
+      stream << result.benchmark << ',' << result.parameter << ',' << result.threadCount << ',' << result.value << ',' << result.unit << std::endl;
+  }
+  else
+  {
+    stream << "{" << std::endl
+           << "  \"name\": \"" << escape(_name) << "\"," << std::endl
+           << "  \"hardwareConcurrency\": " << std::thread::hardware_concurrency() << "," << std::endl
+           << "  \"results\": [";
+    auto separator = "\n";
+    for (const auto& result : _results)
+    {
+      stream << separator << "    { \"benchmark\": \"" << escape(result.benchmark) << "\", \"parameter\": \"" << escape(result.parameter)
+             << "\", \"threads\": " << result.threadCount << ", \"value\": " << result.value << ", \"unit\": \"" << escape(result.unit) << "\" }";
+      separator = ",\n";
+    }
+    stream << std::endl << "  ]" << std::endl << "}" << std::endl;
+  }
+  stream.precision(precision);
+}
@@ -0,0 +1,67 @@
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BenchResult
+{
+  std::string benchmark;
+  std::string parameter;
+  size_t threadCount;
+  double value;
+  std::string unit;
+};
+
+// Collects benchmark results and writes them as JSON or CSV to compare runs between releases
+class BenchReport
+{
+public:
+  // clang-format off
+  enum class Format { JSON, CSV };
+  // clang-format on
+
+public:
+  // Runs the function the given number of times after a warm-up run, returns the median time in seconds
+  template <typename TFn>
+  static double measure(size_t repetitionCount, TFn&& fn);
+  static double median(std::vector<double> values);
+
+public:
+  BenchReport(const std::string& name, Format format);
+
+  void add(BenchResult&& result);
+  void write(std::ostream& stream) const;
+
+private:
+  std::string _name;
+  Format _format;
+  std::vector<BenchResult> _results;
+};
+
+template <typename TFn>
+inline double BenchReport::measure(size_t repetitionCount, TFn&& fn)
+{
+  fn();
+  std::vector<double> times(std::max<size_t>(repetitionCount, 1));
+  for (auto& time : times)
+  {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  return median(std::move(times));
+}
+
+inline double BenchReport::median(std::vector<double> values)
+{
+  if (values.empty())
+    return 0;
+  std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+  return values[values.size() / 2];
+}
+
+#endif // BENCH_REPORT_H
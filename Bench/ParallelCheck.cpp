@@ -0,0 +1,281 @@
+#include <ParallelSelect.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// Checks the results of the parallel sorts against the standard algorithms, returns 1 if any check fails
+
+struct CheckItem
+{
+  uint32_t key;
+  std::string name;
+
+  bool operator==(const CheckItem& other) const { return (key == other.key) && (name == other.name); }
+  bool operator<(const CheckItem& other) const { return (key < other.key) || ((key == other.key) && (name < other.name)); }
+};
+
+// Items are sorted by their keys only, the radix sort keeps the order of equal keys
+template <>
+struct SortRadixKey<CheckItem>
+{
+  static constexpr bool isEnabled = true;
+  using Key = uint32_t;
+
+  static Key key(const CheckItem& value) noexcept { return value.key; }
+};
+
+static_assert(isRadixSortable<int64_t, std::less<>> && isRadixSortable<float, std::less<>> && isRadixSortable<double, std::less<>> &&
+  isRadixSortable<CheckItem, std::less<>> && !isRadixSortable<int64_t, std::greater<>> && !isRadixSortable<std::string, std::less<>>);
+
+static size_t failureCount{ 0 };
+
+static void check(bool isPassed, const std::string& name)
+{
+  if (!isPassed)
+  {
+    ++failureCount;
+    std::cerr << "FAILED: " << name << std::endl;
+  }
+}
+
+static std::string caseName(const std::string& name, size_t size, size_t grain)
+{
+  return name + " (size " + std::to_string(size) + ", grain " + std::to_string(grain) + ")";
+}
+
+// Array sizes with their grains: a chunk per thread, tiny chunks and chunks not dividing the size
+static std::vector<std::pair<size_t, size_t>> checkSizes()
+{
+  std::vector<std::pair<size_t, size_t>> sizes{};
+  for (size_t size : { 0, 1, 2, 5, 1000, 100003 })
+    for (size_t grain : { 0, 1, 7, 1000 })
+      if (!grain || (grain * 1000 >= size))
+        sizes.push_back({ size, grain });
+  return sizes;
+}
+
+// The same values in any order
+template <typename T>
+static bool isPermutation(std::vector<T> l, std::vector<T> r)
+{
+  std::sort(l.begin(), l.end());
+  std::sort(r.begin(), r.end());
+  return l == r;
+}
+
+template <typename T, typename TMakeFn>
+static std::vector<T> makeValues(size_t size, TMakeFn&& makeFn)
+{
+  std::mt19937_64 random{ size };
+  std::vector<T> values(size);
+  for (auto& value : values)
+    value = makeFn(random);
+  return values;
+}
+
+// The result of the compare sort is checked by the order compare: values of a stable sort are compared with std::stable_sort,
+// other equal values may be reordered
+template <typename T, typename TCompare, typename TOrderCompare>
+static void checkSort(
+  TaskLauncher& launcher, const std::string& name, const std::vector<T>& values, TCompare compare, TOrderCompare orderCompare, bool isStable)
+{
+  for (auto [size, grain] : checkSizes())
+  {
+    if (size > values.size())
+      continue;
+    std::vector<T> expected(values.begin(), values.begin() + size);
+    auto sorted = expected;
+    parallelSort(launcher, sorted.begin(), sorted.end(), compare, grain);
+    if (isStable)
+    {
+      std::stable_sort(expected.begin(), expected.end(), orderCompare);
+      check(sorted == expected, caseName(name, size, grain));
+    }
+    else
+      check(std::is_sorted(sorted.begin(), sorted.end(), orderCompare) && isPermutation(sorted, expected), caseName(name, size, grain));
+  }
+}
+
+template <typename T, typename TCompare>
+static void checkSort(TaskLauncher& launcher, const std::string& name, const std::vector<T>& values, TCompare compare, bool isStable)
+{
+  checkSort(launcher, name, values, compare, compare, isStable);
+}
+
+// An interrupted sort leaves all values in the range, a sort finished before the interruption is sorted
+template <typename T, typename TCompare, typename TOrderCompare>
+static void checkInterruptedSort(TaskLauncher& launcher, const std::string& name, const std::vector<T>& values, TCompare compare, TOrderCompare orderCompare)
+{
+  for (size_t interruptCount : { 0, 1, 2, 3, 5, 8, 13 })
+  {
+    auto sorted = values;
+    std::atomic<size_t> callCount{ 0 };
+    auto isInterrupted = false;
+    try
+    {
+      parallelSort(launcher, sorted.begin(), sorted.end(), compare, values.size() / 16, NoSortProgress{},
+        [&callCount, interruptCount]() { return callCount++ >= interruptCount; });
+    }
+    catch (const SortInterrupted&)
+    {
+      isInterrupted = true;
+    }
+    auto caseName = name + " interrupted after " + std::to_string(interruptCount) + " checks";
+    check(isInterrupted || std::is_sorted(sorted.begin(), sorted.end(), orderCompare), caseName + " is sorted");
+    check(interruptCount || isInterrupted, caseName + " is interrupted");
+    check(isPermutation(sorted, values), caseName + " keeps the values");
+  }
+}
+
+// Keys sorted with their payloads are compared with std::stable_sort of the key and payload pairs, so equal keys keep their order
+// and every payload stays with its key. An interrupted sort leaves both arrays unchanged.
+template <typename TKey, typename TCompare>
+static void checkSortByKey(TaskLauncher& launcher, const std::string& name, const std::vector<TKey>& keys, TCompare compare)
+{
+  for (auto [size, grain] : checkSizes())
+  {
+    if (size > keys.size())
+      continue;
+    std::vector<TKey> sortedKeys(keys.begin(), keys.begin() + size);
+    std::vector<std::string> payloads(size);
+    std::vector<std::pair<TKey, std::string>> expected(size);
+    for (size_t index = 0; index < size; ++index)
+    {
+      payloads[index] = "payload " + std::to_string(index);
+      expected[index] = { sortedKeys[index], payloads[index] };
+    }
+    parallelSortByKey(launcher, sortedKeys.begin(), sortedKeys.end(), payloads.begin(), compare, grain);
+    std::stable_sort(expected.begin(), expected.end(), [&compare](const auto& l, const auto& r) { return compare(l.first, r.first); });
+    auto isExpected = true;
+    for (size_t index = 0; index < size; ++index)
+      isExpected = isExpected && (sortedKeys[index] == expected[index].first) && (payloads[index] == expected[index].second);
+    check(isExpected, caseName(name, size, grain));
+  }
+
+  auto sortedKeys = keys;
+  std::vector<std::string> payloads(keys.size(), "payload");
+  try
+  {
+    parallelSortByKey(launcher, sortedKeys.begin(), sortedKeys.end(), payloads.begin(), compare, keys.size() / 16, NoSortProgress{}, []() { return true; });
+  }
+  catch (const SortInterrupted&)
+  {
+  }
+  check((sortedKeys == keys) && (payloads == std::vector<std::string>(keys.size(), "payload")), name + " interrupted keeps the keys and payloads");
+}
+
+// Equal ranges of the compare order, equal values may differ in what the compare ignores
+template <typename TIterator, typename TCompare>
+static bool isEquivalent(TIterator first, TIterator last, TIterator otherFirst, TCompare compare)
+{
+  return std::equal(first, last, otherFirst, [&compare](const auto& l, const auto& r) { return !compare(l, r) && !compare(r, l); });
+}
+
+// The selections are compared with std::partial_sort and std::nth_element for the counts of one value, of a chunk and of the whole range.
+// Few unique values put ties across the chunk borders.
+template <typename T, typename TCompare>
+static void checkSelect(TaskLauncher& launcher, const std::string& name, const std::vector<T>& values, TCompare compare)
+{
+  auto reversedCompare = [&compare](const auto& l, const auto& r) { return compare(r, l); };
+  for (auto [size, grain] : checkSizes())
+  {
+    if (!size || (size > values.size()))
+      continue;
+    std::vector<T> range(values.begin(), values.begin() + size);
+    for (auto count : { size_t{ 1 }, size_t{ 2 }, grain, grain + 1, size / 2, size - 1, size })
+    {
+      if (!count || (count > size))
+        continue;
+      auto countName = caseName(name, size, grain) + " count " + std::to_string(count);
+
+      auto selected = range;
+      auto expected = range;
+      parallelPartialSort(launcher, selected.begin(), selected.begin() + count, selected.end(), compare, grain);
+      std::partial_sort(expected.begin(), expected.begin() + count, expected.end(), compare);
+      check(isEquivalent(selected.begin(), selected.begin() + count, expected.begin(), compare) && isPermutation(selected, range),
+        "partial sort " + countName);
+
+      selected = range;
+      auto nth = selected.begin() + (count - 1);
+      parallelNthElement(launcher, selected.begin(), nth, selected.end(), compare, grain);
+      expected = range;
+      std::nth_element(expected.begin(), expected.begin() + (count - 1), expected.end(), compare);
+      check(isEquivalent(nth, nth + 1, expected.begin() + (count - 1), compare) &&
+          std::none_of(selected.begin(), nth, [&](const auto& value) { return compare(*nth, value); }) &&
+          std::none_of(nth + 1, selected.end(), [&](const auto& value) { return compare(value, *nth); }) && isPermutation(selected, range),
+        "nth element " + countName);
+
+      selected = range;
+      parallelTopK(launcher, selected.begin(), selected.end(), count, compare, grain);
+      expected = range;
+      std::partial_sort(expected.begin(), expected.begin() + count, expected.end(), reversedCompare);
+      check(isEquivalent(selected.begin(), selected.begin() + count, expected.begin(), compare) && isPermutation(selected, range), "top k " + countName);
+    }
+  }
+}
+
+static void checkSorts(TaskLauncher& launcher)
+{
+  static constexpr size_t size = 100003;
+  auto wideInts = makeValues<int64_t>(size, [](auto& random) { return static_cast<int64_t>(random()); });
+  auto fewInts = makeValues<int64_t>(size, [](auto& random) { return static_cast<int64_t>(random() % 16) - 8; });
+  checkSort(launcher, "int64_t radix", wideInts, std::less<>{}, true);
+  checkSort(launcher, "int64_t radix few unique", fewInts, std::less<>{}, true);
+  checkSort(launcher, "int64_t merge", wideInts, std::greater<>{}, true);
+  checkSort(launcher, "int64_t merge few unique", fewInts, std::greater<>{}, true);
+
+  auto makeReal = [](auto& random)
+  {
+    static constexpr double specials[] = { 0.0, -0.0, 1e300, -1e300, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() };
+    auto value = random();
+    return value % 16 ? std::ldexp(static_cast<double>(value >> 11) - static_cast<double>(uint64_t{ 1 } << 52), static_cast<int>(value % 64) - 32)
+                      : specials[(value >> 4) % std::size(specials)];
+  };
+  auto doubles = makeValues<double>(size, makeReal);
+  std::vector<float> floats(doubles.begin(), doubles.end());
+  checkSort(launcher, "float radix", floats, std::less<>{}, true);
+  checkSort(launcher, "double radix", doubles, std::less<>{}, true);
+  checkSort(launcher, "double merge", doubles, std::greater<>{}, true);
+
+  auto items = makeValues<CheckItem>(size, [](auto& random) { return CheckItem{ static_cast<uint32_t>(random() % 1000), std::to_string(random()) }; });
+  auto keyLess = [](const CheckItem& l, const CheckItem& r) { return l.key < r.key; };
+  auto keyGreater = [](const CheckItem& l, const CheckItem& r) { return l.key > r.key; };
+  // The radix sort of the items with std::less compares their keys only
+  checkSort(launcher, "struct radix", items, std::less<>{}, keyLess, true);
+  checkSort(launcher, "struct merge", items, keyGreater, false);
+
+  auto strings = makeValues<std::string>(size, [](auto& random) { return std::to_string(random() % 5000); });
+  checkSort(launcher, "string merge", strings, std::less<>{}, true);
+
+  checkInterruptedSort(launcher, "struct radix", items, std::less<>{}, keyLess);
+  checkInterruptedSort(launcher, "struct merge", items, keyGreater, keyGreater);
+  checkInterruptedSort(launcher, "string merge", strings, std::less<>{}, std::less<>{});
+
+  checkSortByKey(launcher, "by key radix", fewInts, std::less<>{});
+  checkSortByKey(launcher, "by key merge", fewInts, std::greater<>{});
+  checkSortByKey(launcher, "by string key merge", strings, [](const std::string& l, const std::string& r) { return l.size() < r.size(); });
+
+  checkSelect(launcher, "int64_t", std::vector<int64_t>(wideInts.begin(), wideInts.begin() + 1000), std::less<>{});
+  checkSelect(launcher, "int64_t few unique", fewInts, std::less<>{});
+  checkSelect(launcher, "struct", std::vector<CheckItem>(items.begin(), items.begin() + 1000), keyGreater);
+}
+
+int main()
+{
+  TaskLauncher launcher{ 4 };
+  checkSorts(launcher);
+  if (failureCount)
+  {
+    std::cerr << failureCount << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "All checks passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,459 @@
+#include "BenchReport.h"
+
+#include <SpinMutex.h>
+#include <TaskAlgorithms.h>
+#include <TaskLauncher.h>
+#include <TaskStatistics.h>
+#include <ThreadSafeQueue.h>
+#include <WorkerLocal.h>
+
+#include <cmath>
+#ifdef BENCH_STD_EXECUTION
+#include <execution>
+#endif
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+
+struct BenchOptions
+{
+  BenchReport::Format format{ BenchReport::Format::JSON };
+  std::string output{};
+  std::string filter{};
+  size_t repetitionCount{ 5 };
+  ThreadCount maxThreadCount{ std::max<ThreadCount>(std::thread::hardware_concurrency(), 1) };
+};
+
+// 1, 2, 4, ... up to the maximum thread count, which is always included
+static std::vector<ThreadCount> threadCounts(const BenchOptions& options)
+{
+  std::vector<ThreadCount> result{};
+  for (ThreadCount threadCount = 1; threadCount < options.maxThreadCount; threadCount *= 2)
+    result.push_back(threadCount);
+  result.push_back(options.maxThreadCount);
+  return result;
+}
+
+// Runs the function concurrently on the given number of threads, all of them start at once
+template <typename TFn>
+static void runThreads(ThreadCount threadCount, TFn&& fn)
+{
+  std::atomic<ThreadCount> readyCount{ 0 };
+  std::vector<std::thread> threads{};
+  threads.reserve(threadCount);
+  for (ThreadCount threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    threads.emplace_back(
+      [&readyCount, &fn, threadCount, threadIndex]()
+      {
+        ++readyCount;
+        while (readyCount.load() < threadCount)
+          std::this_thread::yield();
+        fn(threadIndex);
+      });
+  for (auto& thread : threads)
+    thread.join();
+}
+
+static void benchTaskLatency(BenchReport& report, const BenchOptions& options)
+{
+  static constexpr size_t taskCount = 20000;
+  for (auto threadCount : { ThreadCount{ 1 }, options.maxThreadCount })
+  {
+    TaskLauncher launcher{ threadCount };
+    TaskHistogram histogram{};
+    for (size_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    {
+      auto start = std::chrono::steady_clock::now();
+      launcher.queueTask([](TaskId) {}).result.wait();
+      histogram.record(std::chrono::steady_clock::now() - start);
+    }
+    report.add({ "taskLatency", "p50", threadCount, double(histogram.percentile(50).count()), "ns" });
+    report.add({ "taskLatency", "p99", threadCount, double(histogram.percentile(99).count()), "ns" });
+    report.add({ "taskLatency", "max", threadCount, double(histogram.max().count()), "ns" });
+    if (threadCount == options.maxThreadCount)
+      break;
+  }
+}
+
+static void benchTaskThroughput(BenchReport& report, const BenchOptions& options)
+{
+  static constexpr size_t taskCount = 100000;
+  for (auto threadCount : threadCounts(options))
+  {
+    TaskLauncher launcher{ threadCount };
+    std::vector<TaskHandle<void>> taskHandles(taskCount);
+    auto time = BenchReport::measure(options.repetitionCount,
+      [&launcher, &taskHandles]()
+      {
+        for (auto& taskHandle : taskHandles)
+          taskHandle = launcher.queueTask([](TaskId) {});
+        for (const auto& taskHandle : taskHandles)
+          taskHandle.result.wait();
+      });
+    report.add({ "taskThroughput", "empty", threadCount, taskCount / time, "tasks/s" });
+  }
+}
+
+static void benchBatchGrain(BenchReport& report, const BenchOptions& options)
+{
+  static constexpr size_t valueCount = 1 << 22;
+  std::vector<double> values(valueCount);
+  std::iota(values.begin(), values.end(), 0.0);
+  TaskLauncher launcher{ options.maxThreadCount };
+  // Grain 0 lets queueBatch split the range evenly between the workers
+  for (size_t grain : { size_t{ 0 }, size_t{ 1 } << 8, size_t{ 1 } << 10, size_t{ 1 } << 12, size_t{ 1 } << 14, size_t{ 1 } << 16, size_t{ 1 } << 18 })
+  {
+    auto time = BenchReport::measure(options.repetitionCount,
+      [&launcher, &values, grain]()
+      {
+        auto taskHandles = launcher.queueBatch(0, values.size(), grain,
+          [&values](TaskId, size_t first, size_t last)
+          {
+            double sum{ 0 };
+            for (auto index = first; index < last; ++index)
+              sum += std::sqrt(values[index]);
+            return sum;
+          });
+        for (const auto& taskHandle : taskHandles)
+          taskHandle.result.wait();
+      });
+    report.add({ "batchGrain", std::to_string(grain), options.maxThreadCount, valueCount / time, "elements/s" });
+  }
+}
+
+static void benchStopAndWait(BenchReport& report, const BenchOptions& options)
+{
+  static constexpr size_t taskCount = 1000;
+  TaskLauncher launcher{ options.maxThreadCount };
+  std::atomic<bool> interruptFlag{ false };
+  std::vector<double> times(std::max<size_t>(options.repetitionCount, 1) * 10);
+  for (auto& time : times)
+  {
+    interruptFlag = false;
+    std::atomic<ThreadCount> runningCount{ 0 };
+    // Busy workers are interrupted, the rest of the tasks stay queued
+    for (size_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+      launcher.queueTask(
+        [&interruptFlag, &runningCount](TaskId)
+        {
+          ++runningCount;
+          while (!interruptFlag.load(std::memory_order_relaxed))
+            std::this_thread::yield();
+          --runningCount;
+        });
+    while (runningCount.load() < launcher.threadCount())
+      std::this_thread::yield();
+    auto start = std::chrono::steady_clock::now();
+    launcher.stopAndWait(&interruptFlag);
+    time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    launcher.clear();
+    launcher.start();
+  }
+  std::sort(times.begin(), times.end());
+  report.add({ "stopAndWait", "p50", options.maxThreadCount, times[times.size() / 2] * 1e9, "ns" });
+  report.add({ "stopAndWait", "max", options.maxThreadCount, times.back() * 1e9, "ns" });
+}
+
+template <typename TMutex>
+static void benchMutex(BenchReport& report, const BenchOptions& options, const std::string& name)
+{
+  static constexpr size_t lockCount = 1 << 18;
+  for (auto threadCount : threadCounts(options))
+  {
+    TMutex mutex{};
+    size_t counter{ 0 };
+    auto time = BenchReport::measure(options.repetitionCount,
+      [&mutex, &counter, threadCount]()
+      {
+        runThreads(threadCount,
+          [&mutex, &counter](ThreadCount)
+          {
+            for (size_t lockIndex = 0; lockIndex < lockCount; ++lockIndex)
+            {
+              std::unique_lock lock{ mutex };
+              ++counter;
+            }
+          });
+      });
+    report.add({ "mutexContention", name, threadCount, lockCount * threadCount / time, "locks/s" });
+  }
+}
+
+static void benchThreadSafeQueue(BenchReport& report, const BenchOptions& options)
+{
+  static constexpr size_t valueCount = 1 << 18;
+  for (auto threadCount : threadCounts(options))
+  {
+    ThreadSafeQueue<size_t> queue{};
+    // Every thread pushes a value and pops one, values of other threads as well
+    auto time = BenchReport::measure(options.repetitionCount,
+      [&queue, threadCount]()
+      {
+        runThreads(threadCount,
+          [&queue](ThreadCount)
+          {
+            size_t value{};
+            for (size_t valueIndex = 0; valueIndex < valueCount; ++valueIndex)
+            {
+              queue.push(size_t{ valueIndex });
+              queue.tryPop(value);
+            }
+          });
+        queue.clear();
+      });
+    report.add({ "threadSafeQueue", "push+pop", threadCount, valueCount * threadCount / time, "pairs/s" });
+  }
+}
+
+// Tasks of a batch count values into a shared atomic counter or into the worker slots of a WorkerLocal
+static void benchWorkerLocal(BenchReport& report, const BenchOptions& options)
+{
+  static constexpr size_t valueCount = 1 << 24;
+  for (auto threadCount : threadCounts(options))
+  {
+    TaskLauncher launcher{ threadCount };
+    std::atomic<size_t> sharedCount{ 0 };
+    auto atomicTime = BenchReport::measure(options.repetitionCount,
+      [&launcher, &sharedCount]()
+      {
+        waitBatch(launcher,
+          launcher.queueBatch(0, valueCount, 0,
+            [&sharedCount](TaskId, size_t from, size_t to)
+            {
+              for (auto index = from; index < to; ++index)
+                sharedCount.fetch_add(index & 1, std::memory_order_relaxed);
+            }));
+      });
+    report.add({ "workerLocal", "atomic", threadCount, valueCount / atomicTime, "elements/s" });
+    WorkerLocal<size_t> localCount{ launcher };
+    auto localTime = BenchReport::measure(options.repetitionCount,
+      [&launcher, &localCount]()
+      {
+        waitBatch(launcher,
+          launcher.queueBatch(0, valueCount, 0,
+            [&localCount](TaskId, size_t from, size_t to)
+            {
+              auto& count = localCount.local();
+              for (auto index = from; index < to; ++index)
+                count += index & 1;
+            }));
+        if (localCount.combine(std::plus<>{}) == 0)
+          std::cerr << "No values are counted" << std::endl;
+      });
+    report.add({ "workerLocal", "WorkerLocal", threadCount, valueCount / localTime, "elements/s" });
+  }
+}
+
+// Two launchers of the maximum thread count run batches at once, with their own threads or drawing from a budget of the maximum thread count
+static void benchThreadBudget(BenchReport& report, const BenchOptions& options)
+{
+  static constexpr size_t valueCount = 1 << 22;
+  std::vector<double> values(valueCount);
+  std::iota(values.begin(), values.end(), 0.0);
+  TaskBudget budget{ options.maxThreadCount };
+  for (auto launcherBudget : { static_cast<TaskBudget*>(nullptr), &budget })
+  {
+    TaskLauncher firstLauncher{ options.maxThreadCount, launcherBudget };
+    TaskLauncher secondLauncher{ options.maxThreadCount, launcherBudget };
+    TaskLauncher* launchers[] = { &firstLauncher, &secondLauncher };
+    auto time = BenchReport::measure(options.repetitionCount,
+      [&launchers, &values]()
+      {
+        runThreads(2,
+          [&launchers, &values](ThreadCount threadIndex)
+          {
+            auto& launcher = *launchers[threadIndex];
+            waitBatch(launcher,
+              launcher.queueBatch(0, values.size(), 1 << 14,
+                [&values](TaskId, size_t first, size_t last)
+                {
+                  double sum{ 0 };
+                  for (auto index = first; index < last; ++index)
+                    sum += std::sqrt(values[index]);
+                  return sum;
+                }));
+          });
+      });
+    report.add({ "threadBudget", launcherBudget ? "TaskBudget" : "unbounded", options.maxThreadCount, 2 * valueCount / time, "elements/s" });
+  }
+}
+
+// Repeated passes over chunks fitting the caches of the cores, queued to any worker or to the workers that ran them in the previous pass.
+// The share of the chunks run by the same worker as in the previous pass shows how many of them could find their values in its cache.
+static void benchAffinity(BenchReport& report, const BenchOptions& options)
+{
+  static constexpr size_t chunkSize = (size_t{ 128 } << 10) / sizeof(double);
+  static constexpr size_t passCount = 100;
+  TaskLauncher launcher{ options.maxThreadCount };
+  std::vector<double> values(chunkSize * 4 * launcher.threadCount(), 1.0);
+  auto chunkCount = values.size() / chunkSize;
+  for (auto isPlaced : { false, true })
+  {
+    BatchPlacement placement{};
+    std::vector<ThreadCount> chunkWorkers(chunkCount, TaskAffinity::anyWorker);
+    std::vector<size_t> sameWorkerCounts(chunkCount, 0);
+    auto passFn = [&launcher, &values, &chunkWorkers, &sameWorkerCounts](TaskId, size_t from, size_t to)
+    {
+      auto chunkIndex = from / chunkSize;
+      auto workerIndex = launcher.workerIndex();
+      sameWorkerCounts[chunkIndex] += chunkWorkers[chunkIndex] == workerIndex ? 1 : 0;
+      chunkWorkers[chunkIndex] = workerIndex;
+      for (auto index = from; index < to; ++index)
+        values[index] = values[index] * 0.5 + 1.0;
+    };
+    auto time = BenchReport::measure(options.repetitionCount,
+      [&launcher, &values, &placement, &passFn, isPlaced]()
+      {
+        for (size_t passIndex = 0; passIndex < passCount; ++passIndex)
+          waitBatch(launcher,
+            isPlaced ? launcher.queueBatch(placement, 0, values.size(), chunkSize, passFn) : launcher.queueBatch(0, values.size(), chunkSize, passFn));
+      });
+    std::string variant{ isPlaced ? "BatchPlacement" : "anyWorker" };
+    // The measurement runs the passes once more to warm up
+    auto runCount = (std::max<size_t>(options.repetitionCount, 1) + 1) * passCount * chunkCount;
+    report.add({ "affinity", variant, launcher.threadCount(), values.size() * passCount / time, "elements/s" });
+    report.add({ "affinity", variant + " sameWorker", launcher.threadCount(),
+      100.0 * std::accumulate(sameWorkerCounts.begin(), sameWorkerCounts.end(), size_t{ 0 }) / runCount, "%" });
+  }
+}
+
+// Runs the algorithm sequentially, on the launcher and with std::execution::par if the standard library provides it
+template <typename TSequentialFn, typename TLauncherFn, typename TParallelFn>
+static void benchAlgorithm(BenchReport& report, const BenchOptions& options, const std::string& name, size_t valueCount, TSequentialFn&& sequentialFn,
+  TLauncherFn&& launcherFn, [[maybe_unused]] TParallelFn&& parallelFn)
+{
+  report.add({ name, "sequential", 1, valueCount / BenchReport::measure(options.repetitionCount, sequentialFn), "elements/s" });
+  TaskLauncher launcher{ options.maxThreadCount };
+  report.add({ name, "TaskLauncher", options.maxThreadCount,
+    valueCount / BenchReport::measure(options.repetitionCount, [&launcher, &launcherFn]() { launcherFn(launcher); }), "elements/s" });
+#ifdef BENCH_STD_EXECUTION
+  report.add({ name, "std::execution::par", std::thread::hardware_concurrency(), valueCount / BenchReport::measure(options.repetitionCount, parallelFn),
+    "elements/s" });
+#endif
+}
+
+static void benchAlgorithms(BenchReport& report, const BenchOptions& options)
+{
+  static constexpr size_t valueCount = 1 << 24;
+  std::vector<double> values(valueCount);
+  std::iota(values.begin(), values.end(), 0.0);
+  std::vector<double> results(valueCount);
+  volatile double sum{ 0 };
+  auto square = [](double value) { return value * value; };
+  benchAlgorithm(report, options, "parallelReduce", valueCount, [&]() { sum = std::reduce(values.begin(), values.end(), 0.0); },
+    [&](TaskLauncher& launcher) { sum = parallelReduce(launcher, values.begin(), values.end(), 0.0); },
+    [&]()
+    {
+#ifdef BENCH_STD_EXECUTION
+      sum = std::reduce(std::execution::par, values.begin(), values.end(), 0.0);
+#endif
+    });
+  benchAlgorithm(report, options, "parallelScan", valueCount, [&]() { std::inclusive_scan(values.begin(), values.end(), results.begin()); },
+    [&](TaskLauncher& launcher) { parallelInclusiveScan(launcher, values.begin(), values.end(), results.begin()); },
+    [&]()
+    {
+#ifdef BENCH_STD_EXECUTION
+      std::inclusive_scan(std::execution::par, values.begin(), values.end(), results.begin());
+#endif
+    });
+  benchAlgorithm(report, options, "parallelTransform", valueCount, [&]() { std::transform(values.begin(), values.end(), results.begin(), square); },
+    [&](TaskLauncher& launcher) { parallelTransform(launcher, values.begin(), values.end(), results.begin(), square); },
+    [&]()
+    {
+#ifdef BENCH_STD_EXECUTION
+      std::transform(std::execution::par, values.begin(), values.end(), results.begin(), square);
+#endif
+    });
+}
+
+static void printUsage()
+{
+  std::cout << "Usage: TaskQueueBench [--format json|csv] [--output FILE] [--filter NAME] [--repetitions N] [--threads N]" << std::endl
+            << "Benchmarks: taskLatency, taskThroughput, batchGrain, stopAndWait, mutexContention, threadSafeQueue, workerLocal, threadBudget, affinity, "
+               "algorithms"
+            << std::endl;
+}
+
+static bool parseOptions(int argc, char* argv[], BenchOptions& options)
+{
+  for (int argIndex = 1; argIndex < argc; ++argIndex)
+  {
+    std::string arg{ argv[argIndex] };
+    if ((arg == "--help") || (arg == "-h") || (argIndex + 1 == argc))
+      return false;
+    std::string value{ argv[++argIndex] };
+    if (arg == "--format")
+    {
+      if ((value != "json") && (value != "csv"))
+        return false;
+      options.format = value == "csv" ? BenchReport::Format::CSV : BenchReport::Format::JSON;
+    }
+    else if (arg == "--output")
+      options.output = value;
+    else if (arg == "--filter")
+      options.filter = value;
+    else if (arg == "--repetitions")
+      options.repetitionCount = std::max(std::stoul(value), 1ul);
+    else if (arg == "--threads")
+      options.maxThreadCount = std::max<ThreadCount>(std::stoul(value), 1);
+    else
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  BenchOptions options{};
+  try
+  {
+    if (!parseOptions(argc, argv, options))
+    {
+      printUsage();
+      return 1;
+    }
+  }
+  catch (const std::exception&)
+  {
+    printUsage();
+    return 1;
+  }
+
+  using BenchFn = void (*)(BenchReport&, const BenchOptions&);
+  const std::pair<const char*, BenchFn> benchmarks[] = {
+    { "taskLatency", benchTaskLatency },
+    { "taskThroughput", benchTaskThroughput },
+    { "batchGrain", benchBatchGrain },
+    { "stopAndWait", benchStopAndWait },
+    { "mutexContention", [](BenchReport& report, const BenchOptions& options) { benchMutex<SpinMutex>(report, options, "SpinMutex"); } },
+    { "mutexContention", [](BenchReport& report, const BenchOptions& options) { benchMutex<std::mutex>(report, options, "std::mutex"); } },
+    { "threadSafeQueue", benchThreadSafeQueue },
+    { "workerLocal", benchWorkerLocal },
+    { "threadBudget", benchThreadBudget },
+    { "affinity", benchAffinity },
+    { "algorithms", benchAlgorithms },
+  };
+
+  BenchReport report{ "TaskQueueBench", options.format };
+  for (const auto& [name, benchFn] : benchmarks)
+    if (options.filter.empty() || (options.filter == name))
+    {
+      std::cerr << "Running " << name << "..." << std::endl;
+      benchFn(report, options);
+    }
+
+  if (options.output.empty())
+    report.write(std::cout);
+  else
+  {
+    std::ofstream stream{ options.output };
+    report.write(stream);
+    if (!stream)
+    {
+      std::cerr << "Failed to write " << options.output << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,146 @@
+#ifndef TASK_ALGORITHMS_H
+#define TASK_ALGORITHMS_H
+
+#include "TaskLauncher.h"
+
+#include <array>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Parallel algorithms over random access ranges, run on the launcher. The range is split into chunks of the grain size
+// (0 is a chunk per thread) processed by the tasks of a batch, the chunks of contiguous ranges are processed by plain index loops,
+// which the compiler vectorizes. A worker of the launcher calling an algorithm executes queued tasks while waiting for the batch.
+
+// Waits for all tasks of the batch before rethrowing the first exception, so no task outlives the data it uses
+template <typename TResult>
+void waitBatch(TaskLauncher& launcher, const std::vector<TaskHandle<TResult>>& taskHandles)
+{
+  for (const auto& taskHandle : taskHandles)
+    launcher.wait(taskHandle);
+  for (const auto& taskHandle : taskHandles)
+    taskHandle.result.get();
+}
+
+template <typename T, typename TIterator, typename TTransformFn, size_t... laneIndices>
+std::array<T, sizeof...(laneIndices)> makeReduceLanes(TIterator first, TTransformFn& transformFn, std::index_sequence<laneIndices...>)
+{
+  return { T(transformFn(first[laneIndices]))... };
+}
+
+// Reduces the chunk by lanes independent of each other, so the loop is vectorized without reassociating the reduction
+template <typename T, typename TIterator, typename TReduceFn, typename TTransformFn>
+T transformReduceChunk(TIterator first, TIterator last, T init, TReduceFn& reduceFn, TTransformFn& transformFn)
+{
+  static constexpr size_t laneCount = 8;
+  auto size = static_cast<size_t>(std::distance(first, last));
+  size_t index{ 0 };
+  if (size >= 2 * laneCount)
+  {
+    auto lanes = makeReduceLanes<T>(first, transformFn, std::make_index_sequence<laneCount>{});
+    for (index = laneCount; index + laneCount <= size; index += laneCount)
+      for (size_t lane = 0; lane < laneCount; ++lane)
+        lanes[lane] = reduceFn(lanes[lane], transformFn(first[index + lane]));
+    for (const auto& lane : lanes)
+      init = reduceFn(init, lane);
+  }
+  for (; index < size; ++index)
+    init = reduceFn(init, transformFn(first[index]));
+  return init;
+}
+
+// Parallel std::transform_reduce: the reduction must be associative and commutative, the chunk results are reduced in order
+template <typename TIterator, typename T, typename TReduceFn, typename TTransformFn>
+T parallelTransformReduce(TaskLauncher& launcher, TIterator first, TIterator last, T init, TReduceFn reduceFn, TTransformFn transformFn, size_t grain = 0)
+{
+  auto taskHandles = launcher.queueBatch(0, static_cast<size_t>(std::distance(first, last)), grain,
+    [first, &reduceFn, &transformFn](TaskId, size_t from, size_t to)
+    { return transformReduceChunk(first + from + 1, first + to, T(transformFn(first[from])), reduceFn, transformFn); });
+  waitBatch(launcher, taskHandles);
+  for (const auto& taskHandle : taskHandles)
+    init = reduceFn(init, taskHandle.result.get());
+  return init;
+}
+
+// Parallel std::reduce
+template <typename TIterator, typename T, typename TReduceFn = std::plus<>>
+T parallelReduce(TaskLauncher& launcher, TIterator first, TIterator last, T init, TReduceFn reduceFn = {}, size_t grain = 0)
+{
+  return parallelTransformReduce(launcher, first, last, std::move(init), reduceFn, [](const auto& value) -> const auto& { return value; }, grain);
+}
+
+// Parallel std::transform, the output may be the input
+template <typename TIterator, typename TOutIterator, typename TTransformFn>
+TOutIterator parallelTransform(TaskLauncher& launcher, TIterator first, TIterator last, TOutIterator out, TTransformFn transformFn, size_t grain = 0)
+{
+  auto size = static_cast<size_t>(std::distance(first, last));
+  waitBatch(launcher,
+    launcher.queueBatch(0, size, grain,
+      [first, out, &transformFn](TaskId, size_t from, size_t to)
+      {
+        for (auto index = from; index < to; ++index)
+          out[index] = transformFn(first[index]);
+      }));
+  return out + size;
+}
+
+// Two-pass scan by blocks of a chunk per thread: the first pass reduces the chunks of the block, the carries of the chunks
+// are scanned by the calling thread, the second pass scans the chunks from their carries while the block is still cached
+// by the workers that reduced them. The grain is the core cache budget if it is 0.
+template <typename T, typename TIterator, typename TOutIterator, typename TScanFn>
+TOutIterator scanBlocks(TaskLauncher& launcher, TIterator first, TIterator last, TOutIterator out, TScanFn& scanFn, std::optional<T> carry, bool isInclusive,
+  size_t grain)
+{
+  using Value = typename std::iterator_traits<TIterator>::value_type;
+  auto size = static_cast<size_t>(std::distance(first, last));
+  if (!grain)
+    grain = std::max<size_t>(coreCacheBudget / sizeof(Value), 1);
+  auto blockSize = grain * launcher.threadCount();
+  std::vector<std::optional<T>> chunkCarries{};
+  BatchPlacement placement{};
+  for (size_t blockFrom = 0; blockFrom < size; blockFrom += blockSize)
+  {
+    auto blockTo = std::min(size, blockFrom + blockSize);
+    auto sumHandles = launcher.queueBatch(placement, blockFrom, blockTo, grain,
+      [first, &scanFn](TaskId, size_t from, size_t to) { return T(std::accumulate(first + from + 1, first + to, T(first[from]), scanFn)); });
+    waitBatch(launcher, sumHandles);
+    chunkCarries.clear();
+    for (const auto& sumHandle : sumHandles)
+    {
+      chunkCarries.push_back(carry);
+      carry = carry ? scanFn(*carry, sumHandle.result.get()) : sumHandle.result.get();
+    }
+    waitBatch(launcher,
+      launcher.queueBatch(placement, blockFrom, blockTo, grain,
+        [first, out, &scanFn, &chunkCarries, blockFrom, grain, isInclusive](TaskId, size_t from, size_t to)
+        {
+          const auto& chunkCarry = chunkCarries[(from - blockFrom) / grain];
+          if (!isInclusive)
+            std::exclusive_scan(first + from, first + to, out + from, *chunkCarry, scanFn);
+          else if (chunkCarry)
+            std::inclusive_scan(first + from, first + to, out + from, scanFn, *chunkCarry);
+          else
+            std::inclusive_scan(first + from, first + to, out + from, scanFn);
+        }));
+  }
+  return out + size;
+}
+
+// Parallel std::inclusive_scan, the scan must be associative, the output may be the input
+template <typename TIterator, typename TOutIterator, typename TScanFn = std::plus<>>
+TOutIterator parallelInclusiveScan(TaskLauncher& launcher, TIterator first, TIterator last, TOutIterator out, TScanFn scanFn = {}, size_t grain = 0)
+{
+  using Value = typename std::iterator_traits<TIterator>::value_type;
+  return scanBlocks<Value>(launcher, first, last, out, scanFn, std::nullopt, true, grain);
+}
+
+// Parallel std::exclusive_scan, the scan must be associative, the output may be the input
+template <typename TIterator, typename TOutIterator, typename T, typename TScanFn = std::plus<>>
+TOutIterator parallelExclusiveScan(TaskLauncher& launcher, TIterator first, TIterator last, TOutIterator out, T init, TScanFn scanFn = {}, size_t grain = 0)
+{
+  return scanBlocks<T>(launcher, first, last, out, scanFn, std::optional<T>{ std::move(init) }, false, grain);
+}
+
+#endif // TASK_ALGORITHMS_H
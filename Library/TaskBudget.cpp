@@ -0,0 +1,101 @@
+#include "TaskBudget.h"
+
+#include <algorithm>
+#include <mutex>
+
+TaskBudget& TaskBudget::global()
+{
+  static TaskBudget _global{};
+  return _global;
+}
+
+TaskBudget::TaskBudget(ThreadCount tokenCount)
+  : _isBusy{}
+  , _tokenCV{}
+  , _tokenCount{ std::max<ThreadCount>(tokenCount, 1) }
+  , _usedTokenCount{ 0 }
+  , _waitingWorkerCount{ 0 }
+  , _accounts{}
+{
+}
+
+void TaskBudget::setTokenCount(ThreadCount tokenCount)
+{
+  {
+    std::unique_lock spinLock{ _isBusy };
+    _tokenCount = std::max<ThreadCount>(tokenCount, 1);
+  }
+  _tokenCV.notify_all();
+}
+
+ThreadCount TaskBudget::tokenCount() const noexcept
+{
+  std::unique_lock spinLock{ _isBusy };
+  return _tokenCount;
+}
+
+ThreadCount TaskBudget::usedTokenCount() const noexcept
+{
+  std::unique_lock spinLock{ _isBusy };
+  return _usedTokenCount;
+}
+
+TaskBudgetAccount* TaskBudget::openAccount(TaskWeight weight)
+{
+  std::unique_lock spinLock{ _isBusy };
+  return &_accounts.emplace_back(TaskBudgetAccount{ std::max<TaskWeight>(weight, 1), 0, 0 });
+}
+
+void TaskBudget::closeAccount(TaskBudgetAccount* account) noexcept
+{
+  {
+    std::unique_lock spinLock{ _isBusy };
+    _accounts.remove_if([account](const TaskBudgetAccount& other) { return &other == account; });
+  }
+  _tokenCV.notify_all();
+}
+
+void TaskBudget::setWeight(TaskBudgetAccount& account, TaskWeight weight)
+{
+  {
+    std::unique_lock spinLock{ _isBusy };
+    account.weight = std::max<TaskWeight>(weight, 1);
+  }
+  _tokenCV.notify_all();
+}
+
+void TaskBudget::acquire(TaskBudgetAccount& account)
+{
+  std::unique_lock spinLock{ _isBusy };
+  ++account.waitingWorkerCount;
+  ++_waitingWorkerCount;
+  _tokenCV.wait(spinLock, [this, &account]() { return (_usedTokenCount < _tokenCount) && isNext(account); });
+  --account.waitingWorkerCount;
+  --_waitingWorkerCount;
+  ++account.heldTokenCount;
+  ++_usedTokenCount;
+  // Workers of other launchers may be next now
+  if (_waitingWorkerCount && (_usedTokenCount < _tokenCount))
+    _tokenCV.notify_all();
+}
+
+void TaskBudget::release(TaskBudgetAccount& account) noexcept
+{
+  bool isWaited{ false };
+  {
+    std::unique_lock spinLock{ _isBusy };
+    --account.heldTokenCount;
+    --_usedTokenCount;
+    isWaited = _waitingWorkerCount != 0;
+  }
+  // Waiting workers of every launcher check whether they are next
+  if (isWaited)
+    _tokenCV.notify_all();
+}
+
+bool TaskBudget::isNext(const TaskBudgetAccount& account) const noexcept
+{
+  return std::none_of(_accounts.begin(), _accounts.end(),
+    [&account](const TaskBudgetAccount& other)
+    { return other.waitingWorkerCount && (other.heldTokenCount * account.weight < account.heldTokenCount * other.weight); });
+}
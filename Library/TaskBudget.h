@@ -0,0 +1,93 @@
+#ifndef TASK_BUDGET_H
+#define TASK_BUDGET_H
+
+#include "TaskQueueExport.h"
+
+#include "SpinMutex.h"
+
+#include <condition_variable>
+#include <list>
+#include <thread>
+
+using ThreadCount = decltype(std::thread::hardware_concurrency());
+using TaskWeight = unsigned;
+
+// Share of a launcher in the budget, guarded by the budget lock
+struct TaskBudgetAccount
+{
+  TaskWeight weight;
+  ThreadCount heldTokenCount;
+  ThreadCount waitingWorkerCount;
+};
+
+// Process-wide limit of the running tasks drawn by launchers: a worker takes a token to run a task and returns it after,
+// so launchers keep their own queues and workers without oversubscribing the CPUs. When the tokens are contended, the next one
+// goes to the launcher holding the fewest tokens per weight.
+class TASKQUEUE_EXPORT TaskBudget
+{
+public:
+  // A token per hardware thread
+  static TaskBudget& global();
+
+public:
+  explicit TaskBudget(ThreadCount tokenCount = std::thread::hardware_concurrency());
+
+  void setTokenCount(ThreadCount tokenCount);
+  ThreadCount tokenCount() const noexcept;
+  ThreadCount usedTokenCount() const noexcept;
+
+  TaskBudgetAccount* openAccount(TaskWeight weight);
+  // The account must not hold tokens
+  void closeAccount(TaskBudgetAccount* account) noexcept;
+  void setWeight(TaskBudgetAccount& account, TaskWeight weight);
+  void acquire(TaskBudgetAccount& account);
+  void release(TaskBudgetAccount& account) noexcept;
+
+private:
+  bool isNext(const TaskBudgetAccount& account) const noexcept;
+
+private:
+  mutable SpinMutex _isBusy;
+  std::condition_variable_any _tokenCV;
+  ThreadCount _tokenCount;
+  ThreadCount _usedTokenCount;
+  ThreadCount _waitingWorkerCount;
+  std::list<TaskBudgetAccount> _accounts;
+};
+
+// Token of a worker thread, acquiring a held token or releasing a returned one does nothing
+class TaskBudgetToken
+{
+public:
+  TaskBudgetToken() noexcept = default;
+  TaskBudgetToken(TaskBudget* budget, TaskBudgetAccount* account) noexcept
+    : _budget{ budget }
+    , _account{ account }
+  {
+  }
+
+  void acquire()
+  {
+    if (_budget && !_isHeld)
+    {
+      _budget->acquire(*_account);
+      _isHeld = true;
+    }
+  }
+
+  void release() noexcept
+  {
+    if (_budget && _isHeld)
+    {
+      _budget->release(*_account);
+      _isHeld = false;
+    }
+  }
+
+private:
+  TaskBudget* _budget{ nullptr };
+  TaskBudgetAccount* _account{ nullptr };
+  bool _isHeld{ false };
+};
+
+#endif // TASK_BUDGET_H
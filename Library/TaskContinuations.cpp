@@ -0,0 +1,32 @@
+#include "TaskContinuations.h"
+
+#include <mutex>
+
+bool TaskContinuations::add(TaskContinuation&& continuation)
+{
+  std::unique_lock spinLock{ _isBusy };
+  if (_finished)
+    return false;
+  _continuations.push_back(std::move(continuation));
+  return true;
+}
+
+void TaskContinuations::finish()
+{
+  std::vector<TaskContinuation> continuations{};
+  {
+    std::unique_lock spinLock{ _isBusy };
+    if (_finished)
+      return;
+    _finished = true;
+    continuations.swap(_continuations);
+  }
+  for (auto& continuation : continuations)
+    continuation();
+}
+
+bool TaskContinuations::isFinished() const noexcept
+{
+  std::unique_lock spinLock{ _isBusy };
+  return _finished;
+}
@@ -0,0 +1,34 @@
+#ifndef TASK_CONTINUATIONS_H
+#define TASK_CONTINUATIONS_H
+
+#include "TaskQueueExport.h"
+
+#include "SpinMutex.h"
+
+#include <functional>
+#include <vector>
+
+using TaskContinuation = std::function<void(void)>;
+
+// Functions called once the task is finished (executed or discarded)
+class TASKQUEUE_EXPORT TaskContinuations
+{
+public:
+  TaskContinuations() = default;
+  // Returns false without saving the continuation if the task is already finished
+  bool add(TaskContinuation&& continuation);
+  void finish();
+  bool isFinished() const noexcept;
+
+  TaskContinuations(const TaskContinuations&) = delete;
+  TaskContinuations(TaskContinuations&&) = delete;
+  TaskContinuations& operator=(const TaskContinuations&) = delete;
+  TaskContinuations& operator=(TaskContinuations&&) = delete;
+
+private:
+  mutable SpinMutex _isBusy;
+  bool _finished{ false };
+  std::vector<TaskContinuation> _continuations;
+};
+
+#endif // TASK_CONTINUATIONS_H
@@ -0,0 +1,74 @@
+#ifndef TASK_COROUTINE_H
+#define TASK_COROUTINE_H
+
+#include "TaskLauncher.h"
+
+#if !defined(__cpp_impl_coroutine)
+#error "TaskCoroutine.h requires C++20 coroutines (configure with -DCOROUTINES=ON)"
+#endif
+
+#include <coroutine>
+
+// Suspends the coroutine until the task is finished. The coroutine is resumed by the thread finishing the task,
+// that is a worker thread of the launcher, unless the task is discarded by TaskLauncher::clear.
+template <typename TResult>
+struct TaskHandleAwaiter
+{
+  bool await_ready() const noexcept { return taskHandle.continuations->isFinished(); }
+  bool await_suspend(std::coroutine_handle<> coroutine) { return taskHandle.continuations->add([coroutine]() { coroutine.resume(); }); }
+  decltype(auto) await_resume() const { return taskHandle.result.get(); }
+
+  TaskHandle<TResult> taskHandle;
+};
+
+template <typename TResult>
+TaskHandleAwaiter<TResult> operator co_await(const TaskHandle<TResult>& taskHandle)
+{
+  return { taskHandle };
+}
+
+template <typename TResult>
+struct TaskCoroutine;
+
+template <typename TResult>
+struct TaskCoroutinePromiseBase
+{
+  TaskCoroutine<TResult> get_return_object() { return { { TaskId{}, _promise.get_future().share(), _continuations } }; }
+  std::suspend_never initial_suspend() const noexcept { return {}; }
+  std::suspend_never final_suspend() noexcept
+  {
+    _continuations->finish();
+    return {};
+  }
+  void unhandled_exception() { _promise.set_exception(std::current_exception()); }
+
+protected:
+  std::promise<TResult> _promise;
+  std::shared_ptr<TaskContinuations> _continuations{ std::make_shared<TaskContinuations>() };
+};
+
+template <typename TResult>
+struct TaskCoroutinePromise : TaskCoroutinePromiseBase<TResult>
+{
+  template <typename TValue>
+  void return_value(TValue&& value)
+  {
+    this->_promise.set_value(std::forward<TValue>(value));
+  }
+};
+
+template <>
+struct TaskCoroutinePromise<void> : TaskCoroutinePromiseBase<void>
+{
+  void return_void() { _promise.set_value(); }
+};
+
+// Eager coroutine: runs on the calling thread until the first suspension, e.g. co_await launcher.schedule().
+// It is awaitable like a task handle, the id of a coroutine is always zero.
+template <typename TResult>
+struct TaskCoroutine : TaskHandle<TResult>
+{
+  using promise_type = TaskCoroutinePromise<TResult>;
+};
+
+#endif // TASK_COROUTINE_H
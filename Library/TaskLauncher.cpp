@@ -1,29 +1,101 @@
 #include "TaskLauncher.h"
 
+#include "SpinMutex.h"
 #include "TaskAwaiterVector.h"
 #include "TaskQueue.h"
+#include "TaskRecorder.h"
+#include "TaskTracer.h"
 
 #include <cassert>
+#include <mutex>
 
-TaskLauncher::TaskLauncher(ThreadCount threadCount)
-  : _taskQueue{ std::make_unique<TaskQueue>() }
+// Launcher owning the current thread, if it is a worker thread
+static thread_local const TaskLauncher* currentLauncher{ nullptr };
+static thread_local size_t currentThreadIndex{ 0 };
+// Budget token of the current worker thread, held while it runs a task
+static thread_local TaskBudgetToken currentToken{};
+
+// Numbers launchers in trace thread names
+static std::atomic<size_t> launcherCount{ 0 };
+
+// Wakes the worker waiting for a task in the queue. The continuation of the task may run after the waiting is over
+// and the launcher is destroyed, a closed slot ignores it.
+struct TaskWakeSlot
+{
+  explicit TaskWakeSlot(TaskQueue* taskQueue)
+    : taskQueue{ taskQueue }
+  {
+  }
+
+  void wake() noexcept
+  {
+    std::unique_lock spinLock{ isBusy };
+    if (taskQueue)
+      taskQueue->wake();
+  }
+
+  void close() noexcept
+  {
+    std::unique_lock spinLock{ isBusy };
+    taskQueue = nullptr;
+  }
+
+  SpinMutex isBusy{};
+  TaskQueue* taskQueue;
+};
+
+TaskLauncher::TaskLauncher(ThreadCount threadCount, TaskBudget* budget, TaskWeight weight)
+  : _taskQueue{ std::make_unique<TaskQueue>(threadCount) }
   , _taskThreads{ threadCount }
   , _taskAwaiterVector{ std::make_unique<TaskAwaiterVector>(threadCount) }
   , _stopStartMutex{}
+#ifdef TASKQUEUE_STATISTICS
+  , _workerRecorders{ std::make_unique<TaskWorkerRecorder[]>(threadCount) }
+#endif
+  , _budget{ budget }
+  , _budgetAccount{ budget ? budget->openAccount(weight) : nullptr }
+  , _queueFullPolicy{ QueueFullPolicy::BLOCK }
 {
-
+  auto launcherIndex = ++launcherCount;
   for (size_t threadIndex = 0; threadIndex < _taskThreads.size(); ++threadIndex)
     if (!_taskThreads[threadIndex].joinable())
       std::thread{
-        [this, threadIndex]()
+        [this, threadIndex, launcherIndex]()
         {
+          currentLauncher = this;
+          currentThreadIndex = threadIndex;
+          currentToken = TaskBudgetToken{ _budget, _budgetAccount };
+          TaskTracer::setThreadName("TaskLauncher " + std::to_string(launcherIndex) + " worker " + std::to_string(threadIndex));
+#ifdef TASKQUEUE_STATISTICS
+          auto& recorder = _workerRecorders[threadIndex];
+#endif
           while (true)
           {
-            auto task{ _taskQueue->pop() };
+#ifdef TASKQUEUE_STATISTICS
+            recorder.startIdle(TaskClock::now());
+#endif
+            // The awaiter is set before the queue can be stopped, so stopAndWait waits for the popped task
+            auto task{ _taskQueue->pop(threadIndex, [this, threadIndex](const Task& task) { _taskAwaiterVector->set(threadIndex, task.taskAwaiter); }) };
             if (task.taskId == finishTaskId())
               break;
-            _taskAwaiterVector->set(threadIndex, task.taskAwaiter);
+            currentToken.acquire();
+#ifdef TASKQUEUE_STATISTICS
+            auto runStart = TaskClock::now();
+            recorder.finishIdle(runStart);
+            recorder.recordQueueTime(runStart - task.queueTime);
+            if ((task.workerIndex != anyWorkerIndex) && (task.workerIndex != threadIndex))
+              TaskWorkerRecorder::increase(recorder.stolenTaskCount, 1);
+#endif
+            TaskTracer::started(task.taskId);
             task.taskFn();
+            TaskTracer::finished(task.taskId);
+#ifdef TASKQUEUE_STATISTICS
+            auto runTime = TaskClock::now() - runStart;
+            TaskWorkerRecorder::increase(recorder.busyTime, runTime.count());
+            TaskWorkerRecorder::increase(recorder.executedTaskCount, 1);
+            recorder.recordRunTime(runTime);
+#endif
+            currentToken.release();
             _taskAwaiterVector->clear(threadIndex);
           }
         }
@@ -42,6 +114,8 @@ TaskLauncher::~TaskLauncher()
       if (taskThread.joinable())
         taskThread.join();
   }
+  if (_budget)
+    _budget->closeAccount(_budgetAccount);
 }
 
 void TaskLauncher::clear() noexcept
@@ -77,14 +151,171 @@ ThreadCount TaskLauncher::threadCount() const noexcept
   return _taskThreads.size();
 }
 
+ThreadCount TaskLauncher::workerIndex() const noexcept
+{
+  return currentLauncher == this ? static_cast<ThreadCount>(currentThreadIndex) : threadCount();
+}
+
+void TaskLauncher::setWeight(TaskWeight weight)
+{
+  if (_budget)
+    _budget->setWeight(*_budgetAccount, weight);
+}
+
 size_t TaskLauncher::taskCount() const noexcept
 {
   return _taskQueue->size();
 }
 
-void TaskLauncher::queueTask(TaskId taskId, TaskFn&& taskFn, TaskAwaiter&& taskAwaiter)
+size_t TaskLauncher::timerCount() const noexcept
 {
-  _taskQueue->push({ taskId, taskFn, taskAwaiter });
+  return _taskQueue->timerCount();
+}
+
+void TaskLauncher::setCapacity(size_t capacity, QueueFullPolicy fullPolicy)
+{
+  _queueFullPolicy.store(fullPolicy, std::memory_order_relaxed);
+  _taskQueue->setCapacity(capacity);
+}
+
+size_t TaskLauncher::capacity() const noexcept
+{
+  return _taskQueue->capacity();
+}
+
+size_t TaskLauncher::highWaterMark() const noexcept
+{
+  return _taskQueue->highWaterMark();
+}
+
+void TaskLauncher::resetHighWaterMark() noexcept
+{
+  _taskQueue->resetHighWaterMark();
+}
+
+TaskStatistics TaskLauncher::statistics() const
+{
+  TaskStatistics statistics{};
+#ifdef TASKQUEUE_STATISTICS
+  auto time = TaskClock::now();
+  statistics.workers.reserve(threadCount());
+  for (size_t threadIndex = 0; threadIndex < threadCount(); ++threadIndex)
+  {
+    statistics.workers.push_back(_workerRecorders[threadIndex].statistics(time));
+    _workerRecorders[threadIndex].mergeHistograms(statistics.queueTime, statistics.runTime);
+  }
+#endif
+  return statistics;
+}
+
+bool TaskLauncher::cancelTimer(TimerId timerId)
+{
+  return _taskQueue->cancelTimer(timerId);
+}
+
+bool TaskLauncher::queueTask(QueueFullPolicy fullPolicy, TaskId taskId, TaskFn&& taskFn, TaskAwaiter&& taskAwaiter, ThreadCount workerIndex, bool isNotifying)
+{
+  TaskTracer::queued(taskId);
+  Task task{ taskId, std::move(taskFn), std::move(taskAwaiter), workerIndex < threadCount() ? workerIndex : anyWorkerIndex };
+  if (_taskQueue->tryPush(task, isNotifying, false))
+    return true;
+  // A worker can't wait for the room made by the workers
+  if ((fullPolicy == QueueFullPolicy::BLOCK) && (currentLauncher != this))
+  {
+    // A worker of another launcher gives its budget token back while blocked, like waitTask: the workers making the room may need it
+    currentToken.release();
+    _taskQueue->tryPush(task, isNotifying, true);
+    currentToken.acquire();
+    return true;
+  }
+  if (fullPolicy == QueueFullPolicy::FAIL)
+    return false;
+  TaskTracer::started(task.taskId);
+  task.taskFn();
+  TaskTracer::finished(task.taskId);
+  return true;
+}
+
+void TaskLauncher::notifyWorkers() noexcept
+{
+  _taskQueue->notifyAll();
+}
+
+TimerId TaskLauncher::queueTimer(TaskTime time, TaskId taskId, TaskFn&& taskFn, TaskAwaiter&& taskAwaiter)
+{
+  TaskTracer::queued(taskId);
+  return _taskQueue->pushTimer(time, TaskClock::duration::zero(), [task = Task{ taskId, taskFn, taskAwaiter }]() { return task; });
+}
+
+TimerId TaskLauncher::queueTimer(TaskTime time, TaskClock::duration period, PeriodicTaskFn&& periodicTaskFn)
+{
+  return _taskQueue->pushTimer(time, period,
+    [periodicTaskFn = std::move(periodicTaskFn)]()
+    {
+      auto taskId = generateTaskId();
+      TaskTracer::queued(taskId);
+      auto task = std::make_shared<std::packaged_task<void()>>(std::bind(periodicTaskFn, taskId));
+      return Task{ taskId, [task]() { task->operator()(); }, [result = task->get_future().share()]() { result.wait(); } };
+    });
+}
+
+void TaskLauncher::waitTask(const TaskReadyFn& taskReadyFn, const TaskAwaiter& taskAwaiter, TaskContinuations& continuations)
+{
+  if (currentLauncher == this)
+  {
+    auto isReady = [&taskReadyFn]() { return taskReadyFn(std::chrono::microseconds::zero()); };
+    std::shared_ptr<TaskWakeSlot> wakeSlot{};
+    while (!isReady())
+    {
+      Task task{};
+      if (!_taskQueue->tryPop(currentThreadIndex, task))
+      {
+        // Without tasks to help with, the worker parks until the task is finished or a task is queued
+        if (!wakeSlot)
+        {
+          wakeSlot = std::make_shared<TaskWakeSlot>(_taskQueue.get());
+          if (!continuations.add([wakeSlot]() { wakeSlot->wake(); }))
+            continue;
+        }
+        currentToken.release();
+        if (!_taskQueue->waitPop(currentThreadIndex, task, isReady))
+          break;
+      }
+      if (task.taskId == finishTaskId())
+      {
+        // The launcher is being destroyed, leave the finish task to the worker loop
+        _taskQueue->push(std::move(task));
+        break;
+      }
+      // The awaiter of the outer task covers the nested one: the outer task can't finish earlier
+      currentToken.acquire();
+#ifdef TASKQUEUE_STATISTICS
+      // The run time of the nested task is a part of the outer task busy time
+      auto& recorder = _workerRecorders[currentThreadIndex];
+      auto runStart = TaskClock::now();
+      recorder.recordQueueTime(runStart - task.queueTime);
+      if ((task.workerIndex != anyWorkerIndex) && (task.workerIndex != currentThreadIndex))
+        TaskWorkerRecorder::increase(recorder.stolenTaskCount, 1);
+      TaskTracer::started(task.taskId);
+      task.taskFn();
+      TaskTracer::finished(task.taskId);
+      recorder.recordRunTime(TaskClock::now() - runStart);
+      TaskWorkerRecorder::increase(recorder.executedTaskCount, 1);
+      TaskWorkerRecorder::increase(recorder.helpedTaskCount, 1);
+#else
+      TaskTracer::started(task.taskId);
+      task.taskFn();
+      TaskTracer::finished(task.taskId);
+#endif
+    }
+    if (wakeSlot)
+      wakeSlot->close();
+  }
+  else if (!taskReadyFn(std::chrono::microseconds::zero()))
+    currentToken.release();
+  taskAwaiter();
+  // The waiting task continues with a token
+  currentToken.acquire();
 }
 
 TaskId TaskLauncher::finishTaskId() noexcept
@@ -93,7 +324,9 @@ TaskId TaskLauncher::finishTaskId() noexcept
   return taskId;
 }
 
-TaskId TaskLauncher::generateTaskId() noexcept
+TaskId TaskLauncher::generateTaskId(TaskId count) noexcept
 {
-  return std::chrono::steady_clock::now().time_since_epoch().count();
+  // Ids are unique within the process, 0 is never used
+  static std::atomic<TaskId> lastTaskId{ 0 };
+  return lastTaskId.fetch_add(count, std::memory_order_relaxed) + 1;
 }
@@ -3,15 +3,25 @@
 
 #include "TaskQueueExport.h"
 
+#include "TaskBudget.h"
+#include "TaskContinuations.h"
+#include "TaskStatistics.h"
+
+#include <algorithm>
+#include <chrono>
 #include <functional>
 #include <future>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
 
-using ThreadCount = decltype(std::thread::hardware_concurrency());
-
 class TaskQueue;
 class TaskAwaiterVector;
+struct TaskWorkerRecorder;
 
 using TaskId = long long;
 
@@ -23,18 +33,99 @@ struct TaskHandle
 {
   TaskId id;
   TaskResult<TResult> result;
+  std::shared_ptr<TaskContinuations> continuations;
+};
+
+using TaskClock = std::chrono::steady_clock;
+using TaskTime = TaskClock::time_point;
+using TimerId = unsigned long long;
+
+template <typename TResult>
+struct TimerHandle : TaskHandle<TResult>
+{
+  TimerId timerId;
+};
+
+// Finishes the task continuations even if the task is discarded without execution
+template <typename TResult>
+struct TaskState
+{
+  template <typename TFn>
+  TaskState(TFn&& fn)
+    : task{ std::forward<TFn>(fn) }
+    , continuations{ std::make_shared<TaskContinuations>() }
+  {
+  }
+
+  ~TaskState()
+  {
+    std::packaged_task<TResult()>{}.swap(task); // breaks the promise of a discarded task before notifying
+    continuations->finish();
+  }
+
+  std::packaged_task<TResult()> task;
+  std::shared_ptr<TaskContinuations> continuations;
 };
 
 using TaskFn = std::function<void(void)>;
 using TaskAwaiter = std::function<void(void)>;
+using PeriodicTaskFn = std::function<void(TaskId)>;
+// Waits for the task result no longer than the given timeout, returns true if the result is ready
+using TaskReadyFn = std::function<bool(std::chrono::microseconds)>;
 
 template <typename TResult>
 using TaskEndEventFn = std::function<void(TaskId, const TaskResult<TResult>&)>;
 
+// Preferred worker of a task: the worker runs the task if it is free, otherwise another worker steals it
+struct TaskAffinity
+{
+  static constexpr ThreadCount anyWorker = std::numeric_limits<ThreadCount>::max();
+
+  ThreadCount workerIndex{ anyWorker };
+};
+
+// What queueTask does if the queue is full: waits until a worker pops a task, throws TaskQueueFull or runs the task on the calling thread
+// clang-format off
+struct _QueueFullPolicy { enum QueueFullPolicy : char { BLOCK, FAIL, RUN_ON_CALLER }; };
+// clang-format on
+using QueueFullPolicy = _QueueFullPolicy::QueueFullPolicy;
+
+// Thrown by queueTask if the queue is full and its policy is FAIL
+class TaskQueueFull : public std::runtime_error
+{
+public:
+  TaskQueueFull()
+    : std::runtime_error{ "The task queue is full!" }
+  {
+  }
+};
+
+// Workers that ran the chunks of a batch. The next batch over the same ranges prefers them for its chunks, so repeated passes
+// find their chunks in the caches of the cores. An empty placement spreads the chunks over the workers in order.
+using BatchPlacement = std::vector<ThreadCount>;
+// Bytes of a chunk that stay in the cache of the core running it (256 KiB), the default grain of the cache-bound algorithms
+inline constexpr size_t coreCacheBudget = size_t{ 256 } << 10;
+
 class TASKQUEUE_EXPORT TaskLauncher
 {
 public:
-  TaskLauncher(ThreadCount threadCount = std::thread::hardware_concurrency());
+  // Awaitable resuming the awaiting coroutine on a worker thread (see TaskCoroutine.h)
+  struct Scheduler
+  {
+    bool await_ready() const noexcept { return false; }
+    template <typename TCoroutineHandle>
+    void await_suspend(TCoroutineHandle coroutine)
+    {
+      launcher.queueTask([coroutine](TaskId) { coroutine.resume(); });
+    }
+    void await_resume() const noexcept {}
+
+    TaskLauncher& launcher;
+  };
+
+public:
+  // Workers of a launcher with a budget run tasks only with its tokens, the weight is the share of the launcher in the contended budget
+  TaskLauncher(ThreadCount threadCount = std::thread::hardware_concurrency(), TaskBudget* budget = nullptr, TaskWeight weight = 1);
   ~TaskLauncher();
 
   template <typename TFn, typename... TArgs, typename TResult = std::invoke_result_t<TFn, TaskId, TArgs...>>
@@ -46,66 +137,207 @@ public:
   template <typename TFn, typename... TArgs, typename TResult = std::invoke_result_t<TFn, TaskId, TArgs...>>
   TaskHandle<TResult> queueTask(const TaskEndEventFn<TResult>& taskEndEventFn, TFn&& fn, TArgs&&... args)
   {
-    auto taskId = generateTaskId();
-    auto task = std::make_shared<std::packaged_task<TResult()>>(std::bind(std::forward<TFn>(fn), taskId, std::forward<TArgs>(args)...));
-    TaskHandle<TResult> taskHandle{ taskId, task->get_future().share() };
+    auto [taskHandle, taskFn, taskAwaiter] = makeTask(generateTaskId(), taskEndEventFn, std::forward<TFn>(fn), std::forward<TArgs>(args)...);
+    if (!queueTask(queueFullPolicy(), taskHandle.id, std::move(taskFn), std::move(taskAwaiter)))
+      throw TaskQueueFull{};
+    return taskHandle;
+  }
+
+  template <typename TFn, typename... TArgs, typename TResult = std::invoke_result_t<TFn, TaskId, TArgs...>>
+  TaskHandle<TResult> queueTask(TaskAffinity affinity, TFn&& fn, TArgs&&... args)
+  {
+    auto [taskHandle, taskFn, taskAwaiter] = makeTask(generateTaskId(), TaskEndEventFn<TResult>{}, std::forward<TFn>(fn), std::forward<TArgs>(args)...);
+    if (!queueTask(queueFullPolicy(), taskHandle.id, std::move(taskFn), std::move(taskAwaiter), affinity.workerIndex))
+      throw TaskQueueFull{};
+    return taskHandle;
+  }
+
+  // Queues the task only if the queue is not full, whatever its policy
+  template <typename TFn, typename... TArgs, typename TResult = std::invoke_result_t<TFn, TaskId, TArgs...>>
+  std::optional<TaskHandle<TResult>> tryQueueTask(TFn&& fn, TArgs&&... args)
+  {
+    auto [taskHandle, taskFn, taskAwaiter] = makeTask(generateTaskId(), TaskEndEventFn<TResult>{}, std::forward<TFn>(fn), std::forward<TArgs>(args)...);
+    if (!queueTask(QueueFullPolicy::FAIL, taskHandle.id, std::move(taskFn), std::move(taskAwaiter)))
+      return std::nullopt;
+    return taskHandle;
+  }
+
+  // Queues the task at the given time, timers have a millisecond resolution and are expired by idle workers
+  template <typename TFn, typename... TArgs, typename TResult = std::invoke_result_t<TFn, TaskId, TArgs...>>
+  TimerHandle<TResult> queueTaskAt(TaskTime time, TFn&& fn, TArgs&&... args)
+  {
+    auto [taskHandle, taskFn, taskAwaiter] = makeTask(generateTaskId(), TaskEndEventFn<TResult>{}, std::forward<TFn>(fn), std::forward<TArgs>(args)...);
+    auto timerId = queueTimer(time, taskHandle.id, std::move(taskFn), std::move(taskAwaiter));
+    return { taskHandle, timerId };
+  }
 
-    queueTask(
-      taskHandle.id,
+  template <typename TRep, typename TPeriod, typename TFn, typename... TArgs, typename TResult = std::invoke_result_t<TFn, TaskId, TArgs...>>
+  TimerHandle<TResult> queueTaskAfter(std::chrono::duration<TRep, TPeriod> delay, TFn&& fn, TArgs&&... args)
+  {
+    return queueTaskAt(TaskClock::now() + delay, std::forward<TFn>(fn), std::forward<TArgs>(args)...);
+  }
+
+  // Queues the task every period (missed periods are skipped), each run gets a new task id and its result is ignored
+  template <typename TRep, typename TPeriod, typename TFn, typename... TArgs>
+  TimerId queuePeriodicTask(std::chrono::duration<TRep, TPeriod> period, TFn&& fn, TArgs&&... args)
+  {
+    return queueTimer(TaskClock::now() + period, std::chrono::duration_cast<TaskClock::duration>(period),
+      std::bind(std::forward<TFn>(fn), std::placeholders::_1, std::forward<TArgs>(args)...));
+  }
+
+  // Tasks of a batch get contiguous ids in the order of their ranges. A full queue never fails a batch, its chunks are run
+  // on the calling thread instead.
+  template <typename TFn, typename TResult = std::invoke_result_t<TFn, TaskId, size_t, size_t>>
+  std::vector<TaskHandle<TResult>> queueBatch(size_t first, size_t last, size_t grain, TFn&& fn, const TaskEndEventFn<TResult>& taskEndEventFn = {})
+  {
+    return queuePlacedBatch(nullptr, first, last, grain, std::forward<TFn>(fn), taskEndEventFn);
+  }
+
+  // Queues the chunks to the workers of the placement and records the workers running them into it (see BatchPlacement),
+  // the placement must outlive the tasks of the batch
+  template <typename TFn, typename TResult = std::invoke_result_t<TFn, TaskId, size_t, size_t>>
+  std::vector<TaskHandle<TResult>> queueBatch(
+    BatchPlacement& placement, size_t first, size_t last, size_t grain, TFn&& fn, const TaskEndEventFn<TResult>& taskEndEventFn = {})
+  {
+    return queuePlacedBatch(&placement, first, last, grain, std::forward<TFn>(fn), taskEndEventFn);
+  }
+
+  // Waits for the task completion. If called from a worker thread of this launcher, the worker executes other queued tasks
+  // while waiting, so tasks that wait for other tasks do not exhaust the pool, and parks in the queue when there are none until
+  // the task is finished or another is queued. A worker of any launcher returns its budget token while it is blocked.
+  template <typename TResult>
+  void wait(const TaskHandle<TResult>& taskHandle)
+  {
+    const auto& result = taskHandle.result;
+    waitTask([&result](std::chrono::microseconds timeout) { return result.wait_for(timeout) == std::future_status::ready; }, [&result]() { result.wait(); },
+      *taskHandle.continuations);
+  }
+
+  template <typename TResult>
+  decltype(auto) get(const TaskHandle<TResult>& taskHandle)
+  {
+    wait(taskHandle);
+    return taskHandle.result.get();
+  }
+
+  Scheduler schedule() noexcept { return { *this }; }
+
+  // Cancels a pending timer, a cancelled one-shot task is discarded like a cleared one
+  bool cancelTimer(TimerId timerId);
+
+  void clear() noexcept;
+  void stop() noexcept;
+  void stopAndWait(std::atomic<bool>* interruptFlag = nullptr);
+  void start();
+  ThreadCount threadCount() const noexcept;
+  // Index of the worker of this launcher running the calling thread, threadCount() for other threads
+  ThreadCount workerIndex() const noexcept;
+  TaskBudget* budget() const noexcept { return _budget; }
+  void setWeight(TaskWeight weight);
+  size_t taskCount() const noexcept;
+  size_t timerCount() const noexcept;
+  // Limits the queued tasks (0 is unbounded, the default) with the policy applied to a full queue. A worker of the launcher
+  // never blocks on its queue, it runs the task itself. A blocked worker of another launcher releases its task budget slot
+  // until the task is queued. Expired timers are queued beyond the capacity.
+  void setCapacity(size_t capacity, QueueFullPolicy fullPolicy = QueueFullPolicy::BLOCK);
+  size_t capacity() const noexcept;
+  QueueFullPolicy queueFullPolicy() const noexcept { return _queueFullPolicy.load(std::memory_order_relaxed); }
+  // The greatest number of queued tasks since the launcher creation or the last reset
+  size_t highWaterMark() const noexcept;
+  void resetHighWaterMark() noexcept;
+  // Snapshot of the worker counters and the queue/run time histograms, empty without the STATISTICS build option
+  TaskStatistics statistics() const;
+
+protected:
+  // Reserves the given number of contiguous ids, returns the first one
+  static TaskId generateTaskId(TaskId count = 1) noexcept;
+  static TaskId finishTaskId() noexcept;
+
+protected:
+  template <typename TFn, typename... TArgs, typename TResult = std::invoke_result_t<TFn, TaskId, TArgs...>>
+  std::tuple<TaskHandle<TResult>, TaskFn, TaskAwaiter> makeTask(TaskId taskId, const TaskEndEventFn<TResult>& taskEndEventFn, TFn&& fn, TArgs&&... args)
+  {
+    auto task = std::make_shared<TaskState<TResult>>(std::bind(std::forward<TFn>(fn), taskId, std::forward<TArgs>(args)...));
+    TaskHandle<TResult> taskHandle{ taskId, task->task.get_future().share(), task->continuations };
+
+    return { taskHandle,
       [task, taskHandle, taskEndEventFn]()
       {
-        task->operator()();
+        task->task();
         if (taskEndEventFn)
           taskEndEventFn(taskHandle.id, taskHandle.result);
+        taskHandle.continuations->finish();
       },
-      [result = taskHandle.result]() { result.wait(); });
-    return taskHandle;
+      [result = taskHandle.result]() { result.wait(); } };
   }
 
   template <typename TFn, typename TResult = std::invoke_result_t<TFn, TaskId, size_t, size_t>>
-  std::vector<TaskHandle<TResult>> queueBatch(size_t first, size_t last, size_t grain, TFn&& fn, const TaskEndEventFn<TResult>& taskEndEventFn = {})
+  std::vector<TaskHandle<TResult>> queuePlacedBatch(
+    BatchPlacement* placement, size_t first, size_t last, size_t grain, TFn&& fn, const TaskEndEventFn<TResult>& taskEndEventFn)
   {
     std::vector<TaskHandle<TResult>> taskHandles{};
     auto count = last - first;
     if (count == 0)
       return taskHandles;
-    if (grain >= count)
+    if (grain == 0)
+      grain = count / threadCount() + (count % threadCount() ? 1 : 0);
+    grain = std::min(grain, count);
+    auto taskCount = count % grain ? (count / grain) + 1 : count / grain;
+    if (placement && (placement->size() != taskCount))
     {
-      taskHandles.push_back(queueTask(std::forward<TFn>(fn), first, last));
+      placement->resize(taskCount);
+      for (size_t chunkIndex = 0; chunkIndex < taskCount; ++chunkIndex)
+        (*placement)[chunkIndex] = static_cast<ThreadCount>(chunkIndex % threadCount());
     }
-    else
+    auto taskId = generateTaskId(taskCount);
+    taskHandles.reserve(taskCount);
+    // The queued chunks may use the data of the caller, so the batch is not abandoned halfway
+    auto fullPolicy = queueFullPolicy() == QueueFullPolicy::FAIL ? QueueFullPolicy::RUN_ON_CALLER : queueFullPolicy();
+    // Every task gets its own copy of the function
+    for (auto from = first; from < last; from += grain, ++taskId)
     {
-      if (grain == 0)
-        grain = count / threadCount() + (count % threadCount() ? 1 : 0);
-      taskHandles.reserve(count % grain ? (count / grain) + 1 : count / grain);
-      for (auto from = first; from < last; from += grain)
+      auto to = std::min(last, from + grain);
+      auto [taskHandle, taskFn, taskAwaiter] = makeTask(taskId, taskEndEventFn, fn, from, to);
+      if (placement)
       {
-        auto to = std::min(last, from + grain);
-        taskHandles.push_back(queueTask(taskEndEventFn, std::forward<TFn>(fn), from, to));
+        // Idle workers are woken after the whole batch is queued, so they don't steal the chunks of the workers not woken yet
+        auto& chunkWorker = (*placement)[taskHandles.size()];
+        queueTask(fullPolicy, taskHandle.id,
+          [this, &chunkWorker, taskFn = std::move(taskFn)]()
+          {
+            chunkWorker = workerIndex();
+            taskFn();
+          },
+          std::move(taskAwaiter), chunkWorker, false);
       }
+      else
+        queueTask(fullPolicy, taskHandle.id, std::move(taskFn), std::move(taskAwaiter));
+      taskHandles.push_back(std::move(taskHandle));
     }
+    if (placement)
+      notifyWorkers();
     return taskHandles;
   }
 
-  void clear() noexcept;
-  void stop() noexcept;
-  void stopAndWait(std::atomic<bool>* interruptFlag = nullptr);
-  void start();
-  ThreadCount threadCount() const noexcept;
-  size_t taskCount() const noexcept;
-
-protected:
-  static TaskId generateTaskId() noexcept;
-  static TaskId finishTaskId() noexcept;
-
-protected:
-  void queueTask(TaskId taskId, TaskFn&& taskFn, TaskAwaiter&& taskAwaiter);
+  // Returns false if the queue is full and the policy is FAIL. A worker index out of the workers means any worker, a task queued
+  // without notification waits for notifyWorkers or another task.
+  bool queueTask(QueueFullPolicy fullPolicy, TaskId taskId, TaskFn&& taskFn, TaskAwaiter&& taskAwaiter, ThreadCount workerIndex = TaskAffinity::anyWorker,
+    bool isNotifying = true);
+  void notifyWorkers() noexcept;
+  TimerId queueTimer(TaskTime time, TaskId taskId, TaskFn&& taskFn, TaskAwaiter&& taskAwaiter);
+  TimerId queueTimer(TaskTime time, TaskClock::duration period, PeriodicTaskFn&& periodicTaskFn);
+  // The continuations of the task wake the waiting worker parked in the queue
+  void waitTask(const TaskReadyFn& taskReadyFn, const TaskAwaiter& taskAwaiter, TaskContinuations& continuations);
 
 private:
   std::unique_ptr<TaskQueue> _taskQueue;
   std::vector<std::thread> _taskThreads;
   std::unique_ptr<TaskAwaiterVector> _taskAwaiterVector;
   std::mutex _stopStartMutex;
+  std::unique_ptr<TaskWorkerRecorder[]> _workerRecorders;
+  TaskBudget* _budget;
+  TaskBudgetAccount* _budgetAccount;
+  std::atomic<QueueFullPolicy> _queueFullPolicy;
 };
 
 #endif // TASK_LAUNCHER_H
@@ -1,43 +1,208 @@
 #include "TaskQueue.h"
 
-TaskQueue::TaskQueue()
+#include "TaskTracer.h"
+
+#include <algorithm>
+
+TaskQueue::TaskQueue(size_t workerCount)
   : _isBusy{}
   , _queue{}
+  , _workerQueues(workerCount)
+  , _idleWorkers(workerCount, false)
+  , _workerTaskCount{ 0 }
   , _taskCV{}
+  , _spaceCV{}
+  , _capacity{ 0 }
+  , _highWaterMark{ 0 }
+  , _waitingPusherCount{ 0 }
   , _started{ true }
+  , _timers{}
+  , _timerOrigin{ TaskClock::now() }
+  , _timerKeeper{ false }
+  , _timerKeeperTick{ 0 }
 {
 }
 
-Task TaskQueue::pop()
+Task TaskQueue::pop(size_t workerIndex, const std::function<void(const Task&)>& popFn)
 {
   Task task{};
+  size_t notifyCount{ 0 };
+  auto isSpaceWaited = false;
   {
     std::unique_lock spinLock{ _isBusy };
-    _taskCV.wait(spinLock, [this]() noexcept { return isStarted() && _queue.size(); });
-    task = std::move(_queue.back());
-    _queue.pop_back();
+    auto wasTimerKeeper = false;
+    auto isWorker = workerIndex < _idleWorkers.size();
+    while (true)
+    {
+      notifyCount += expireTimers();
+      if (isStarted() && takeTask(workerIndex, task))
+        break;
+      if (isWorker)
+        _idleWorkers[workerIndex] = true;
+      if (!_timerKeeper && !_timers.empty())
+      {
+        _timerKeeper = wasTimerKeeper = true;
+        _timerKeeperTick = _timers.nextTick();
+        TaskTracer::begin("parked (timers)");
+        _taskCV.wait_until(spinLock, timerTime(_timerKeeperTick));
+        TaskTracer::end("parked (timers)");
+        _timerKeeper = false;
+      }
+      else
+      {
+        TaskTracer::begin("parked");
+        _taskCV.wait(spinLock);
+        TaskTracer::end("parked");
+      }
+      if (isWorker)
+        _idleWorkers[workerIndex] = false;
+    }
+    if (popFn)
+      popFn(task);
+    // Wake idle workers for the rest of the expired tasks and for keeping the timers instead of this one
+    notifyCount = (notifyCount ? notifyCount - 1 : 0) + (wasTimerKeeper && !_timers.empty() ? 1 : 0);
+    isSpaceWaited = _waitingPusherCount != 0;
   }
+  if (notifyCount > 1)
+    _taskCV.notify_all();
+  else if (notifyCount)
+    _taskCV.notify_one();
+  if (isSpaceWaited)
+    _spaceCV.notify_one();
   return task;
 }
 
-void TaskQueue::push(Task&& task)
+bool TaskQueue::tryPop(size_t workerIndex, Task& task)
+{
+  size_t notifyCount{ 0 };
+  auto isPopped = false;
+  auto isSpaceWaited = false;
+  {
+    std::unique_lock spinLock{ _isBusy };
+    notifyCount = expireTimers();
+    isPopped = isStarted() && takeTask(workerIndex, task);
+    // Wake idle workers for the expired tasks this caller doesn't run
+    if (isPopped && notifyCount)
+      --notifyCount;
+    isSpaceWaited = isPopped && (_waitingPusherCount != 0);
+  }
+  if (notifyCount > 1)
+    _taskCV.notify_all();
+  else if (notifyCount)
+    _taskCV.notify_one();
+  if (isSpaceWaited)
+    _spaceCV.notify_one();
+  return isPopped;
+}
+
+bool TaskQueue::waitPop(size_t workerIndex, Task& task, const std::function<bool()>& isReady)
+{
+  size_t notifyCount{ 0 };
+  auto isPopped = false;
+  auto isSpaceWaited = false;
+  {
+    std::unique_lock spinLock{ _isBusy };
+    auto isWorker = workerIndex < _idleWorkers.size();
+    while (true)
+    {
+      notifyCount += expireTimers();
+      if (isStarted() && takeTask(workerIndex, task))
+      {
+        isPopped = true;
+        break;
+      }
+      if (isReady())
+        break;
+      if (isWorker)
+        _idleWorkers[workerIndex] = true;
+      // The waiting worker doesn't keep the timers, it only wakes for their expiration
+      TaskTracer::begin("parked (waiting)");
+      if (!_timers.empty())
+        _taskCV.wait_until(spinLock, timerTime(_timers.nextTick()));
+      else
+        _taskCV.wait(spinLock);
+      TaskTracer::end("parked (waiting)");
+      if (isWorker)
+        _idleWorkers[workerIndex] = false;
+    }
+    if (isPopped && notifyCount)
+      --notifyCount;
+    isSpaceWaited = isPopped && (_waitingPusherCount != 0);
+  }
+  if (notifyCount > 1)
+    _taskCV.notify_all();
+  else if (notifyCount)
+    _taskCV.notify_one();
+  if (isSpaceWaited)
+    _spaceCV.notify_one();
+  return isPopped;
+}
+
+void TaskQueue::push(Task&& task, bool isNotifying)
+{
+  auto isWorkerIdle = false;
+  {
+    std::unique_lock spinLock{ _isBusy };
+    isWorkerIdle = pushTask(std::move(task));
+  }
+  if (isNotifying)
+    notifyPushed(isWorkerIdle);
+}
+
+bool TaskQueue::tryPush(Task& task, bool isNotifying, bool isWaiting)
+{
+  auto isWorkerIdle = false;
+  {
+    std::unique_lock spinLock{ _isBusy };
+    if (isFull())
+    {
+      // Tasks queued without notification are popped to make room
+      if (!isNotifying)
+        _taskCV.notify_all();
+      if (!isWaiting)
+        return false;
+      ++_waitingPusherCount;
+      TaskTracer::begin("blocked (queue full)");
+      _spaceCV.wait(spinLock, [this]() { return !isFull(); });
+      TaskTracer::end("blocked (queue full)");
+      --_waitingPusherCount;
+    }
+    isWorkerIdle = pushTask(std::move(task));
+  }
+  if (isNotifying)
+    notifyPushed(isWorkerIdle);
+  return true;
+}
+
+void TaskQueue::notifyAll() noexcept
+{
+  _taskCV.notify_all();
+}
+
+void TaskQueue::wake() noexcept
 {
   {
     std::unique_lock spinLock{ _isBusy };
-    _queue.push_back(std::move(task));
   }
-  _taskCV.notify_one();
+  _taskCV.notify_all();
 }
 
 void TaskQueue::clearAndPush(std::vector<Task>&& tasks)
 {
+  decltype(_queue) queue{}; // discarded tasks are destroyed outside the lock, they may queue new tasks
+  decltype(_workerQueues) workerQueues(_workerQueues.size());
+  decltype(_timers.clear()) timers{};
   {
     std::unique_lock spinLock{ _isBusy };
-    _queue.clear();
+    _queue.swap(queue);
+    _workerQueues.swap(workerQueues);
+    _workerTaskCount = 0;
+    timers = _timers.clear();
     for (auto& task : tasks)
       _queue.push_back(std::move(task));
   }
   _taskCV.notify_all();
+  _spaceCV.notify_all();
 }
 
 bool TaskQueue::isStarted() const noexcept
@@ -47,6 +212,8 @@ bool TaskQueue::isStarted() const noexcept
 
 void TaskQueue::stop() noexcept
 {
+  // Waits for a task being popped
+  std::unique_lock spinLock{ _isBusy };
   _started.store(false, std::memory_order_release);
 }
 
@@ -58,12 +225,164 @@ void TaskQueue::start() noexcept
 
 void TaskQueue::clear() noexcept
 {
-  std::unique_lock spinLock{ _isBusy };
-  _queue.clear();
+  decltype(_queue) queue{};
+  decltype(_workerQueues) workerQueues(_workerQueues.size());
+  {
+    std::unique_lock spinLock{ _isBusy };
+    _queue.swap(queue);
+    _workerQueues.swap(workerQueues);
+    _workerTaskCount = 0;
+  }
+  _spaceCV.notify_all();
 }
 
 size_t TaskQueue::size() const noexcept
 {
   std::unique_lock spinLock{ _isBusy };
-  return _queue.size();
+  return queuedCount();
+}
+
+void TaskQueue::setCapacity(size_t capacity)
+{
+  {
+    std::unique_lock spinLock{ _isBusy };
+    _capacity = capacity;
+  }
+  _spaceCV.notify_all();
+}
+
+size_t TaskQueue::capacity() const noexcept
+{
+  std::unique_lock spinLock{ _isBusy };
+  return _capacity;
+}
+
+size_t TaskQueue::highWaterMark() const noexcept
+{
+  std::unique_lock spinLock{ _isBusy };
+  return _highWaterMark;
+}
+
+void TaskQueue::resetHighWaterMark() noexcept
+{
+  std::unique_lock spinLock{ _isBusy };
+  _highWaterMark = queuedCount();
+}
+
+TimerId TaskQueue::pushTimer(TaskTime time, TaskClock::duration period, TaskFactory&& taskFactory)
+{
+  auto periodTicks = period.count() > 0 ? std::max<TimerTick>(std::chrono::ceil<std::chrono::milliseconds>(period) / timerResolution, 1) : 0;
+  TimerId timerId{};
+  auto notifyAll = false;
+  auto notifyOne = false;
+  {
+    std::unique_lock spinLock{ _isBusy };
+    timerId = _timers.insert(timerTick(time), periodTicks, std::move(taskFactory));
+    notifyAll = _timerKeeper && (_timers.nextTick() < _timerKeeperTick); // the keeper sleeps too long
+    notifyOne = !_timerKeeper;                                            // an idle worker becomes the keeper
+  }
+  if (notifyAll)
+    _taskCV.notify_all();
+  else if (notifyOne)
+    _taskCV.notify_one();
+  return timerId;
+}
+
+bool TaskQueue::cancelTimer(TimerId timerId)
+{
+  TaskFactory taskFactory{}; // destroyed outside the lock like discarded tasks
+  std::unique_lock spinLock{ _isBusy };
+  return _timers.cancel(timerId, taskFactory);
+}
+
+size_t TaskQueue::timerCount() const noexcept
+{
+  std::unique_lock spinLock{ _isBusy };
+  return _timers.size();
+}
+
+TimerTick TaskQueue::timerTick(TaskTime time) const noexcept
+{
+  // Rounded up, a timer never expires earlier than its time
+  return time > _timerOrigin ? std::chrono::ceil<std::chrono::milliseconds>(time - _timerOrigin) / timerResolution : 0;
+}
+
+TaskTime TaskQueue::timerTime(TimerTick tick) const noexcept
+{
+  return _timerOrigin + tick * timerResolution;
+}
+
+size_t TaskQueue::expireTimers()
+{
+  if (_timers.empty())
+    return 0;
+  auto queueSize = _queue.size();
+  _timers.expire(std::chrono::floor<std::chrono::milliseconds>(TaskClock::now() - _timerOrigin) / timerResolution,
+    [this](TaskFactory& taskFactory)
+    {
+      _queue.push_back(taskFactory());
+#ifdef TASKQUEUE_STATISTICS
+      _queue.back().queueTime = TaskClock::now();
+#endif
+    });
+  _highWaterMark = std::max(_highWaterMark, queuedCount());
+  return _queue.size() - queueSize;
+}
+
+bool TaskQueue::pushTask(Task&& task)
+{
+#ifdef TASKQUEUE_STATISTICS
+  task.queueTime = TaskClock::now();
+#endif
+  auto isWorkerIdle = false;
+  if (auto workerIndex = task.workerIndex; workerIndex < _workerQueues.size())
+  {
+    isWorkerIdle = _idleWorkers[workerIndex];
+    _workerQueues[workerIndex].push_back(std::move(task));
+    ++_workerTaskCount;
+  }
+  else
+    _queue.push_back(std::move(task));
+  _highWaterMark = std::max(_highWaterMark, queuedCount());
+  return isWorkerIdle;
+}
+
+void TaskQueue::notifyPushed(bool isWorkerIdle) noexcept
+{
+  // The idle preferred worker can't be woken alone, the other woken workers leave the task to it
+  if (isWorkerIdle)
+    _taskCV.notify_all();
+  else
+    _taskCV.notify_one();
+}
+
+bool TaskQueue::takeTask(size_t workerIndex, Task& task)
+{
+  if ((workerIndex < _workerQueues.size()) && !_workerQueues[workerIndex].empty())
+  {
+    task = std::move(_workerQueues[workerIndex].back());
+    _workerQueues[workerIndex].pop_back();
+    --_workerTaskCount;
+    return true;
+  }
+  if (!_queue.empty())
+  {
+    task = std::move(_queue.back());
+    _queue.pop_back();
+    return true;
+  }
+  // Steals the task a busy worker would take last
+  for (size_t offset = 1; _workerTaskCount && (offset <= _workerQueues.size()); ++offset)
+  {
+    auto victimIndex = (workerIndex + offset) % _workerQueues.size();
+    if (auto& victimQueue = _workerQueues[victimIndex]; !victimQueue.empty() && !_idleWorkers[victimIndex])
+    {
+      task = std::move(victimQueue.front());
+      victimQueue.pop_front();
+      --_workerTaskCount;
+      TaskTracer::stolen(task.taskId, victimIndex);
+      return true;
+    }
+  }
+  return false;
 }
@@ -2,41 +2,108 @@
 #define TASK_QUEUE_H
 
 #include "SpinMutex.h"
+#include "TimerWheel.h"
 
+#include <chrono>
 #include <condition_variable>
 #include <deque>
 #include <functional>
+#include <limits>
 #include <vector>
 
 using TaskId = long long;
 using TaskFn = std::function<void(void)>;
 using TaskAwaiter = std::function<void(void)>;
 
+using TaskClock = std::chrono::steady_clock;
+using TaskTime = TaskClock::time_point;
+
+// Worker index of a task without a preferred worker
+inline constexpr size_t anyWorkerIndex = std::numeric_limits<size_t>::max();
+
 struct Task
 {
   TaskId taskId;
   TaskFn taskFn;
   TaskAwaiter taskAwaiter;
+  size_t workerIndex{ anyWorkerIndex };
+#ifdef TASKQUEUE_STATISTICS
+  TaskTime queueTime{};
+#endif
 };
 
+// Makes the task to queue when a timer expires
+using TaskFactory = std::function<Task(void)>;
+
+// Tasks with a preferred worker wait in the queue of the worker, which takes them before the shared tasks. A worker without tasks
+// steals the oldest task of a busy worker, the tasks of an idle worker are left to it.
 class TaskQueue
 {
 public:
-  TaskQueue();
-  Task pop();
-  void push(Task&& task);
+  explicit TaskQueue(size_t workerCount = 0);
+  // The popped task is passed to the function under the queue lock, so the queue is not stopped between them
+  Task pop(size_t workerIndex, const std::function<void(const Task&)>& popFn = {});
+  bool tryPop(size_t workerIndex, Task& task);
+  // Pops a task, waiting for it until isReady returns true (then returns false without a task). The predicate is checked
+  // under the queue lock, wake must be called once it becomes true.
+  bool waitPop(size_t workerIndex, Task& task, const std::function<bool()>& isReady);
+  // Pushing without notification defers waking the workers until notifyAll, e.g. until a batch is queued
+  void push(Task&& task, bool isNotifying = true);
+  // Pushes the task within the capacity: if the queue is full, waits until a task is popped if isWaiting, otherwise leaves
+  // the task and returns false
+  bool tryPush(Task& task, bool isNotifying, bool isWaiting);
+  void notifyAll() noexcept;
+  // Wakes the workers waiting in waitPop, the lock orders the wake after their check of the predicate
+  void wake() noexcept;
   void clearAndPush(std::vector<Task>&& tasks);
   bool isStarted() const noexcept;
   void stop() noexcept;
   void start() noexcept;
   void clear() noexcept;
   size_t size() const noexcept;
+  // Limit of the pushed tasks, 0 is unbounded. Expired timers and pushed tasks are queued beyond it.
+  void setCapacity(size_t capacity);
+  size_t capacity() const noexcept;
+  // The greatest number of queued tasks
+  size_t highWaterMark() const noexcept;
+  void resetHighWaterMark() noexcept;
+
+  // Zero period means a one-shot timer
+  TimerId pushTimer(TaskTime time, TaskClock::duration period, TaskFactory&& taskFactory);
+  bool cancelTimer(TimerId timerId);
+  size_t timerCount() const noexcept;
+
+private:
+  static constexpr std::chrono::milliseconds timerResolution{ 1 };
+
+  TimerTick timerTick(TaskTime time) const noexcept;
+  TaskTime timerTime(TimerTick tick) const noexcept;
+  size_t expireTimers();
+  size_t queuedCount() const noexcept { return _queue.size() + _workerTaskCount; }
+  bool isFull() const noexcept { return _capacity && (queuedCount() >= _capacity); }
+  // Returns true if the preferred worker of the task is idle
+  bool pushTask(Task&& task);
+  void notifyPushed(bool isWorkerIdle) noexcept;
+  bool takeTask(size_t workerIndex, Task& task);
 
 private:
   mutable SpinMutex _isBusy;
   std::deque<Task> _queue;
+  std::vector<std::deque<Task>> _workerQueues;
+  std::vector<char> _idleWorkers;
+  size_t _workerTaskCount;
   std::condition_variable_any _taskCV;
+  // Pushers wait for a popped task while the queue is full
+  std::condition_variable_any _spaceCV;
+  size_t _capacity;
+  size_t _highWaterMark;
+  size_t _waitingPusherCount;
   std::atomic<bool> _started;
+  TimerWheel<TaskFactory> _timers;
+  TaskTime _timerOrigin;
+  // Idle worker sleeping until the next timer tick, other idle workers sleep until notified
+  bool _timerKeeper;
+  TimerTick _timerKeeperTick;
 };
 
 #endif // TASK_QUEUE_H
@@ -0,0 +1,56 @@
+#ifndef TASK_RECORDER_H
+#define TASK_RECORDER_H
+
+#include "TaskStatistics.h"
+
+#include <algorithm>
+#include <atomic>
+
+// Statistics of a worker. It is written by the worker only, so the counters are updated without read-modify-write
+// operations, and read by TaskLauncher::statistics concurrently.
+struct alignas(64) TaskWorkerRecorder
+{
+  using Counter = std::atomic<uint64_t>;
+
+  static void increase(Counter& counter, uint64_t value) noexcept { counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); }
+
+  void recordQueueTime(TaskHistogram::Duration duration) noexcept { increase(queueTimeBuckets[TaskHistogram::bucketIndex(std::max<int64_t>(duration.count(), 0))], 1); }
+  void recordRunTime(TaskHistogram::Duration duration) noexcept { increase(runTimeBuckets[TaskHistogram::bucketIndex(std::max<int64_t>(duration.count(), 0))], 1); }
+
+  void startIdle(std::chrono::steady_clock::time_point time) noexcept { idleStartTime.store(time.time_since_epoch().count(), std::memory_order_relaxed); }
+  void finishIdle(std::chrono::steady_clock::time_point time) noexcept
+  {
+    increase(idleTime, time.time_since_epoch().count() - idleStartTime.load(std::memory_order_relaxed));
+    idleStartTime.store(0, std::memory_order_relaxed);
+  }
+
+  TaskWorkerStatistics statistics(std::chrono::steady_clock::time_point time) const noexcept
+  {
+    // The current idle period is taken into account as well
+    auto idleStart = idleStartTime.load(std::memory_order_relaxed);
+    auto currentIdleTime = idleStart ? std::max<int64_t>(time.time_since_epoch().count() - idleStart, 0) : 0;
+    return { executedTaskCount.load(std::memory_order_relaxed), helpedTaskCount.load(std::memory_order_relaxed),
+      stolenTaskCount.load(std::memory_order_relaxed), std::chrono::nanoseconds(busyTime.load(std::memory_order_relaxed)),
+      std::chrono::nanoseconds(idleTime.load(std::memory_order_relaxed) + currentIdleTime) };
+  }
+
+  void mergeHistograms(TaskHistogram& queueTime, TaskHistogram& runTime) const noexcept
+  {
+    for (uint32_t bucketIndex = 0; bucketIndex < TaskHistogram::bucketCount; ++bucketIndex)
+    {
+      queueTime.add(bucketIndex, queueTimeBuckets[bucketIndex].load(std::memory_order_relaxed));
+      runTime.add(bucketIndex, runTimeBuckets[bucketIndex].load(std::memory_order_relaxed));
+    }
+  }
+
+  Counter executedTaskCount{ 0 };
+  Counter helpedTaskCount{ 0 };
+  Counter stolenTaskCount{ 0 };
+  Counter busyTime{ 0 };
+  Counter idleTime{ 0 };
+  std::atomic<int64_t> idleStartTime{ 0 };
+  Counter queueTimeBuckets[TaskHistogram::bucketCount]{};
+  Counter runTimeBuckets[TaskHistogram::bucketCount]{};
+};
+
+#endif // TASK_RECORDER_H
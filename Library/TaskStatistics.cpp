@@ -0,0 +1,84 @@
+#include "TaskStatistics.h"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static uint32_t highestBit(uint64_t value) noexcept
+{
+#ifdef _MSC_VER
+  unsigned long bit{};
+  _BitScanReverse64(&bit, value);
+  return bit;
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+uint32_t TaskHistogram::bucketIndex(uint64_t value) noexcept
+{
+  if (value < subBucketCount)
+    return static_cast<uint32_t>(value);
+  auto bit = highestBit(value);
+  if (bit >= maxValueBits)
+    return bucketCount - 1;
+  auto shift = bit - subBucketBits;
+  return (shift + 1) * subBucketCount + static_cast<uint32_t>(value >> shift) - subBucketCount;
+}
+
+uint64_t TaskHistogram::bucketValue(uint32_t bucketIndex) noexcept
+{
+  if (bucketIndex < subBucketCount)
+    return bucketIndex;
+  auto shift = bucketIndex / subBucketCount - 1;
+  auto subBucket = bucketIndex % subBucketCount;
+  return ((uint64_t(subBucketCount + subBucket) + 1) << shift) - 1;
+}
+
+void TaskHistogram::record(Duration duration) noexcept
+{
+  add(bucketIndex(duration.count() > 0 ? duration.count() : 0), 1);
+}
+
+void TaskHistogram::add(uint32_t bucketIndex, uint64_t count) noexcept
+{
+  _buckets[bucketIndex] += count;
+  _count += count;
+}
+
+void TaskHistogram::merge(const TaskHistogram& histogram) noexcept
+{
+  for (uint32_t bucketIndex = 0; bucketIndex < bucketCount; ++bucketIndex)
+    _buckets[bucketIndex] += histogram._buckets[bucketIndex];
+  _count += histogram._count;
+}
+
+TaskHistogram::Duration TaskHistogram::percentile(double percentile) const noexcept
+{
+  if (!_count)
+    return Duration::zero();
+  auto rank = static_cast<uint64_t>(std::clamp(percentile, 0.0, 100.0) / 100.0 * _count);
+  uint64_t count{ 0 };
+  for (uint32_t bucketIndex = 0; bucketIndex < bucketCount; ++bucketIndex)
+    if ((count += _buckets[bucketIndex]) > rank || (count == _count))
+      return Duration(bucketValue(bucketIndex));
+  return Duration::zero();
+}
+
+TaskHistogram::Duration TaskHistogram::min() const noexcept
+{
+  for (uint32_t bucketIndex = 0; bucketIndex < bucketCount; ++bucketIndex)
+    if (_buckets[bucketIndex])
+      return Duration(bucketValue(bucketIndex));
+  return Duration::zero();
+}
+
+TaskHistogram::Duration TaskHistogram::max() const noexcept
+{
+  for (auto bucketIndex = bucketCount; bucketIndex > 0; --bucketIndex)
+    if (_buckets[bucketIndex - 1])
+      return Duration(bucketValue(bucketIndex - 1));
+  return Duration::zero();
+}
@@ -0,0 +1,65 @@
+#ifndef TASK_STATISTICS_H
+#define TASK_STATISTICS_H
+
+#include "TaskQueueExport.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Log-linear histogram of durations (HDR style): every power of two range is split into equal sub-buckets,
+// so the relative error of a percentile doesn't exceed 1 / subBucketCount.
+class TASKQUEUE_EXPORT TaskHistogram
+{
+public:
+  using Duration = std::chrono::nanoseconds;
+
+  static constexpr uint32_t subBucketBits = 4;
+  static constexpr uint32_t subBucketCount = 1 << subBucketBits;
+  // Durations up to 2^40 ns (about 18 minutes) are distinguished, longer ones fall into the last bucket
+  static constexpr uint32_t maxValueBits = 40;
+  static constexpr uint32_t bucketCount = (maxValueBits - subBucketBits + 1) * subBucketCount;
+
+  static uint32_t bucketIndex(uint64_t value) noexcept;
+  static uint64_t bucketValue(uint32_t bucketIndex) noexcept;
+
+public:
+  TaskHistogram() = default;
+
+  void record(Duration duration) noexcept;
+  void add(uint32_t bucketIndex, uint64_t count) noexcept;
+  void merge(const TaskHistogram& histogram) noexcept;
+
+  uint64_t count() const noexcept { return _count; }
+  // Returns the upper bound of the bucket containing the given percentile (0..100)
+  Duration percentile(double percentile) const noexcept;
+  Duration min() const noexcept;
+  Duration max() const noexcept;
+
+private:
+  std::array<uint64_t, bucketCount> _buckets{};
+  uint64_t _count{ 0 };
+};
+
+struct TaskWorkerStatistics
+{
+  uint64_t executedTaskCount;
+  // Tasks executed by the worker while it was waiting for another task (see TaskLauncher::wait)
+  uint64_t helpedTaskCount;
+  // Tasks preferring another worker executed by the worker (see TaskAffinity)
+  uint64_t stolenTaskCount;
+  std::chrono::nanoseconds busyTime;
+  std::chrono::nanoseconds idleTime;
+};
+
+struct TaskStatistics
+{
+  // Empty if the library is built without statistics (STATISTICS CMake option)
+  std::vector<TaskWorkerStatistics> workers;
+  // Time from queuing a task (or expiring its timer) to its start
+  TaskHistogram queueTime;
+  TaskHistogram runTime;
+};
+
+#endif // TASK_STATISTICS_H
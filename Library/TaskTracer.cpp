@@ -0,0 +1,225 @@
+#include "TaskTracer.h"
+
+#include "SpinMutex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// clang-format off
+struct _TraceEventPhase { enum TraceEventPhase : char { QUEUED, BEGIN, END, TASK_BEGIN, TASK_END, STOLEN }; };
+// clang-format on
+using TraceEventPhase = _TraceEventPhase::TraceEventPhase;
+
+struct TraceEvent
+{
+  const char* name;
+  TaskId taskId;
+  int64_t time;
+  size_t victimIndex;
+  TraceEventPhase phase;
+};
+
+// Written by its thread only, the lock is contended just while dumping
+struct TraceBuffer
+{
+  SpinMutex isBusy;
+  size_t threadIndex;
+  std::string threadName;
+  std::vector<TraceEvent> events;
+  size_t eventCount;
+};
+
+struct TraceBuffers
+{
+  std::mutex mutex;
+  std::vector<std::shared_ptr<TraceBuffer>> buffers;
+  size_t eventCount{ TaskTracer::defaultEventCount };
+  size_t threadCount{ 0 };
+};
+
+static TraceBuffers& traceBuffers()
+{
+  static TraceBuffers _traceBuffers{};
+  return _traceBuffers;
+}
+
+static TraceBuffer& traceBuffer()
+{
+  // The buffer outlives its thread to be dumped
+  static thread_local std::shared_ptr<TraceBuffer> _traceBuffer{};
+  if (!_traceBuffer)
+  {
+    // The buffer is kept only once registered, so a failed allocation is retried by the next call
+    auto& buffers = traceBuffers();
+    std::unique_lock lock{ buffers.mutex };
+    auto traceBuffer = std::make_shared<TraceBuffer>();
+    traceBuffer->threadIndex = buffers.threadCount + 1;
+    traceBuffer->threadName = "Thread " + std::to_string(traceBuffer->threadIndex);
+    if (TaskTracer::isStarted())
+      traceBuffer->events.resize(buffers.eventCount);
+    traceBuffer->eventCount = 0;
+    buffers.buffers.push_back(traceBuffer);
+    ++buffers.threadCount;
+    _traceBuffer = std::move(traceBuffer);
+  }
+  return *_traceBuffer;
+}
+
+static void record(const char* name, TaskId taskId, TraceEventPhase phase, size_t victimIndex = 0) noexcept
+{
+  auto time = std::chrono::steady_clock::now().time_since_epoch().count();
+  // Named threads and the thread starting the tracer have their buffers already, the buffer of another thread is created
+  // by its first event, which is dropped if the buffer can't be allocated
+  TraceBuffer* buffer{ nullptr };
+  try
+  {
+    buffer = &traceBuffer();
+  }
+  catch (...)
+  {
+    return;
+  }
+  std::unique_lock spinLock{ buffer->isBusy };
+  if (!buffer->events.empty())
+    buffer->events[buffer->eventCount++ % buffer->events.size()] = { name, taskId, time, victimIndex, phase };
+}
+
+static void writeString(std::ostream& stream, const std::string& value)
+{
+  stream << '"';
+  for (auto ch : value)
+    if ((ch == '"') || (ch == '\\'))
+      stream << '\\' << ch;
+    else if (static_cast<unsigned char>(ch) >= ' ')
+      stream << ch;
+  stream << '"';
+}
+
+std::atomic<bool> TaskTracer::_started{ false };
+
+void TaskTracer::start(size_t eventCount)
+{
+  traceBuffer();
+  auto& buffers = traceBuffers();
+  std::unique_lock lock{ buffers.mutex };
+  buffers.eventCount = eventCount;
+  // Buffers owned by the registry only belong to finished threads, their events are discarded anyway
+  buffers.buffers.erase(std::remove_if(buffers.buffers.begin(), buffers.buffers.end(), [](const auto& buffer) { return buffer.use_count() == 1; }),
+    buffers.buffers.end());
+  for (auto& buffer : buffers.buffers)
+  {
+    std::unique_lock spinLock{ buffer->isBusy };
+    buffer->events.assign(eventCount, TraceEvent{});
+    buffer->eventCount = 0;
+  }
+  _started.store(true, std::memory_order_relaxed);
+}
+
+void TaskTracer::stop() noexcept
+{
+  _started.store(false, std::memory_order_relaxed);
+}
+
+void TaskTracer::dump(std::ostream& stream)
+{
+  auto& buffers = traceBuffers();
+  std::unique_lock lock{ buffers.mutex };
+  auto flags = stream.flags();
+  auto separator = "\n";
+  stream << std::fixed << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  for (auto& buffer : buffers.buffers)
+  {
+    std::vector<TraceEvent> events{};
+    std::string threadName{};
+    {
+      std::unique_lock spinLock{ buffer->isBusy };
+      auto first = buffer->eventCount > buffer->events.size() ? buffer->eventCount - buffer->events.size() : 0;
+      events.reserve(buffer->eventCount - first);
+      for (auto eventIndex = first; eventIndex < buffer->eventCount; ++eventIndex)
+        events.push_back(buffer->events[eventIndex % buffer->events.size()]);
+      threadName = buffer->threadName;
+    }
+
+    stream << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadIndex << ",\"args\":{\"name\":";
+    writeString(stream, threadName);
+    stream << "}}";
+    separator = ",\n";
+
+    for (const auto& event : events)
+    {
+      static constexpr char phases[] = { 'X', 'B', 'E', 'B', 'E', 'i' };
+      auto time = event.time / 1000.0; // microseconds
+      stream << separator << "{\"ph\":\"" << phases[event.phase] << "\",\"pid\":1,\"tid\":" << buffer->threadIndex << ",\"ts\":" << time;
+      if (event.phase == TraceEventPhase::QUEUED)
+      {
+        // Flow from a short queuing slice to the task slice, see the "f" event below
+        stream << ",\"dur\":0.001,\"name\":\"queue\",\"cat\":\"task\",\"args\":{\"taskId\":" << event.taskId << "}}";
+        stream << separator << "{\"ph\":\"s\",\"name\":\"queue\",\"cat\":\"task\",\"pid\":1,\"tid\":" << buffer->threadIndex << ",\"ts\":" << time
+               << ",\"id\":\"" << event.taskId << "\"}";
+      }
+      else if (event.phase == TraceEventPhase::STOLEN)
+      {
+        // Instant event of the thread
+        stream << ",\"s\":\"t\",\"name\":\"steal\",\"cat\":\"task\",\"args\":{\"taskId\":" << event.taskId << ",\"victim\":" << event.victimIndex
+               << "}}";
+      }
+      else
+      {
+        stream << ",\"name\":";
+        writeString(stream, event.name);
+        stream << ",\"cat\":\"task\",\"args\":{\"taskId\":" << event.taskId << "}}";
+        if (event.phase == TraceEventPhase::TASK_BEGIN)
+          stream << separator << "{\"ph\":\"f\",\"bp\":\"e\",\"name\":\"queue\",\"cat\":\"task\",\"pid\":1,\"tid\":" << buffer->threadIndex
+                 << ",\"ts\":" << time << ",\"id\":\"" << event.taskId << "\"}";
+      }
+    }
+  }
+  stream << "\n]}\n";
+  stream.flags(flags);
+}
+
+void TaskTracer::setThreadName(const std::string& name)
+{
+  auto& buffer = traceBuffer();
+  std::unique_lock spinLock{ buffer.isBusy };
+  buffer.threadName = name;
+}
+
+void TaskTracer::queued(TaskId taskId) noexcept
+{
+  if (isStarted())
+    record(nullptr, taskId, TraceEventPhase::QUEUED);
+}
+
+void TaskTracer::started(TaskId taskId) noexcept
+{
+  if (isStarted())
+    record("task", taskId, TraceEventPhase::TASK_BEGIN);
+}
+
+void TaskTracer::finished(TaskId taskId) noexcept
+{
+  if (isStarted())
+    record("task", taskId, TraceEventPhase::TASK_END);
+}
+
+void TaskTracer::stolen(TaskId taskId, size_t victimIndex) noexcept
+{
+  if (isStarted())
+    record(nullptr, taskId, TraceEventPhase::STOLEN, victimIndex);
+}
+
+void TaskTracer::begin(const char* name, TaskId taskId) noexcept
+{
+  if (isStarted())
+    record(name, taskId, TraceEventPhase::BEGIN);
+}
+
+void TaskTracer::end(const char* name, TaskId taskId) noexcept
+{
+  if (isStarted())
+    record(name, taskId, TraceEventPhase::END);
+}
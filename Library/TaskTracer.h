@@ -0,0 +1,68 @@
+#ifndef TASK_TRACER_H
+#define TASK_TRACER_H
+
+#include "TaskQueueExport.h"
+
+#include <atomic>
+#include <ostream>
+#include <string>
+
+using TaskId = long long;
+
+// Process-wide execution tracing. Events are recorded into per-thread ring buffers (the oldest events are overwritten)
+// and dumped as Chrome trace JSON, which can be loaded into Perfetto or chrome://tracing.
+// Event names must be string literals: only the pointers are recorded.
+class TASKQUEUE_EXPORT TaskTracer
+{
+public:
+  static constexpr size_t defaultEventCount = 1 << 16;
+
+  // Clears the recorded events and starts recording, eventCount is the ring buffer size of every thread
+  static void start(size_t eventCount = defaultEventCount);
+  static void stop() noexcept;
+  static bool isStarted() noexcept { return _started.load(std::memory_order_relaxed); }
+  static void dump(std::ostream& stream);
+
+  // Also allocates the event buffer of the thread, which is otherwise allocated by its first event
+  static void setThreadName(const std::string& name);
+
+  // The task with the given id is queued by the current thread, it starts and finishes on a worker thread
+  static void queued(TaskId taskId) noexcept;
+  static void started(TaskId taskId) noexcept;
+  static void finished(TaskId taskId) noexcept;
+  // The current thread takes the task from the queue of the victim worker
+  static void stolen(TaskId taskId, size_t victimIndex) noexcept;
+  static void begin(const char* name, TaskId taskId = 0) noexcept;
+  static void end(const char* name, TaskId taskId = 0) noexcept;
+
+private:
+  static std::atomic<bool> _started;
+};
+
+// Named span of the current thread
+class TaskTraceSpan
+{
+public:
+  TaskTraceSpan(const char* name, TaskId taskId = 0) noexcept
+    : _name{ TaskTracer::isStarted() ? name : nullptr }
+    , _taskId{ taskId }
+  {
+    if (_name)
+      TaskTracer::begin(_name, _taskId);
+  }
+
+  ~TaskTraceSpan()
+  {
+    if (_name)
+      TaskTracer::end(_name, _taskId);
+  }
+
+  TaskTraceSpan(const TaskTraceSpan&) = delete;
+  TaskTraceSpan& operator=(const TaskTraceSpan&) = delete;
+
+private:
+  const char* _name;
+  TaskId _taskId;
+};
+
+#endif // TASK_TRACER_H
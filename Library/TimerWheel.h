@@ -0,0 +1,295 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using TimerId = unsigned long long;
+using TimerTick = uint64_t;
+
+// Hierarchical timer wheel with O(1) insertion and cancellation. A timer is kept at the level of the highest tick digit
+// in which its deadline differs from the current tick, and cascades down when the current tick reaches its slot.
+// Timers are stored in a slab and linked into the slot lists by indexes, a timer id is the slab index with a generation.
+template <typename T>
+class TimerWheel
+{
+public:
+  static constexpr TimerTick noTick() noexcept { return std::numeric_limits<TimerTick>::max(); }
+
+public:
+  TimerWheel() { _slots.fill(noIndex); }
+
+  TimerTick currentTick() const noexcept { return _currentTick; }
+  size_t size() const noexcept { return _size; }
+  bool empty() const noexcept { return !_size; }
+
+  // The deadline must be later than the current tick, zero period means a one-shot timer
+  TimerId insert(TimerTick deadline, TimerTick period, T&& value);
+  // Moves the value of the pending timer out
+  bool cancel(TimerId timerId, T& value);
+  // The earliest tick at which the wheel has work to do (fire or cascade timers)
+  TimerTick nextTick() const noexcept;
+  // Advances the current tick, calls expireFn(T&) for each expired timer in deadline order
+  template <typename TExpireFn>
+  void expire(TimerTick tick, TExpireFn&& expireFn);
+  // Moves all pending values out
+  std::vector<T> clear();
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel(TimerWheel&&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+  TimerWheel& operator=(TimerWheel&&) = delete;
+
+private:
+  static constexpr uint32_t slotBits = 8;
+  static constexpr uint32_t slotCount = 1 << slotBits;
+  static constexpr uint32_t levelCount = 4;
+  static constexpr uint32_t overflowSlot = levelCount * slotCount;
+  static constexpr uint32_t noIndex = std::numeric_limits<uint32_t>::max();
+  static constexpr uint32_t maskWordCount = slotCount / 64;
+
+  struct Timer
+  {
+    TimerTick deadline;
+    TimerTick period;
+    uint32_t prev;
+    uint32_t next;
+    uint32_t slot;
+    uint32_t generation;
+    T value;
+  };
+
+  static uint32_t slotIndex(TimerTick tick, uint32_t level) noexcept { return (tick >> (level * slotBits)) & (slotCount - 1); }
+  static uint32_t firstBit(uint64_t word) noexcept
+  {
+#ifdef _MSC_VER
+    unsigned long bit{};
+    _BitScanForward64(&bit, word);
+    return bit;
+#else
+    return __builtin_ctzll(word);
+#endif
+  }
+
+  uint32_t allocate(TimerTick deadline, TimerTick period, T&& value);
+  void release(uint32_t index) noexcept;
+  void link(uint32_t index) noexcept;
+  void unlink(uint32_t index) noexcept;
+  uint32_t detach(uint32_t slot) noexcept;
+  uint32_t firstSlot(uint32_t level, uint32_t from) const noexcept;
+
+private:
+  TimerTick _currentTick{ 0 };
+  size_t _size{ 0 };
+  std::vector<Timer> _timers{};
+  std::vector<uint32_t> _freeTimers{};
+  std::array<uint32_t, overflowSlot + 1> _slots;
+  std::array<std::array<uint64_t, maskWordCount>, levelCount> _slotMasks{};
+};
+
+template <typename T>
+inline TimerId TimerWheel<T>::insert(TimerTick deadline, TimerTick period, T&& value)
+{
+  auto index = allocate(deadline > _currentTick ? deadline : _currentTick + 1, period, std::move(value));
+  link(index);
+  ++_size;
+  return (static_cast<TimerId>(_timers[index].generation) << 32) | index;
+}
+
+template <typename T>
+inline bool TimerWheel<T>::cancel(TimerId timerId, T& value)
+{
+  auto index = static_cast<uint32_t>(timerId);
+  if ((index >= _timers.size()) || (_timers[index].generation != static_cast<uint32_t>(timerId >> 32)) || (_timers[index].slot == noIndex))
+    return false;
+  unlink(index);
+  value = std::move(_timers[index].value);
+  release(index);
+  --_size;
+  return true;
+}
+
+template <typename T>
+inline TimerTick TimerWheel<T>::nextTick() const noexcept
+{
+  if (!_size)
+    return noTick();
+  for (uint32_t level = 0; level < levelCount; ++level)
+  {
+    // Slots at or before the current one are already processed, except the current slot of the lowest level
+    auto current = slotIndex(_currentTick, level);
+    if (auto slot = firstSlot(level, level ? current + 1 : current); slot != noIndex)
+    {
+      auto levelShift = level * slotBits;
+      auto epochShift = levelShift + slotBits;
+      return ((_currentTick >> epochShift) << epochShift) | (static_cast<TimerTick>(slot) << levelShift);
+    }
+  }
+  // Only the timers beyond the highest level remain
+  constexpr auto wheelBits = levelCount * slotBits;
+  return ((_currentTick >> wheelBits) + 1) << wheelBits;
+}
+
+template <typename T>
+template <typename TExpireFn>
+inline void TimerWheel<T>::expire(TimerTick tick, TExpireFn&& expireFn)
+{
+  for (auto nextTick = this->nextTick(); nextTick <= tick; nextTick = this->nextTick())
+  {
+    auto epochChanged = (nextTick >> (levelCount * slotBits)) != (_currentTick >> (levelCount * slotBits));
+    _currentTick = nextTick;
+
+    // Cascade the timers of the reached slots down to the lower levels
+    for (auto slot = epochChanged ? overflowSlot : (levelCount - 1) * slotCount + slotIndex(_currentTick, levelCount - 1);;)
+    {
+      for (auto index = detach(slot), next = noIndex; index != noIndex; index = next)
+      {
+        next = _timers[index].next;
+        link(index);
+      }
+      auto level = slot == overflowSlot ? levelCount : slot / slotCount;
+      if (level == 1)
+        break;
+      slot = (level - 1) * slotCount + slotIndex(_currentTick, level - 1);
+    }
+
+    // Fire the timers of the lowest level slot
+    for (auto index = detach(slotIndex(_currentTick, 0)), next = noIndex; index != noIndex; index = next)
+    {
+      auto& timer = _timers[index];
+      next = timer.next;
+      timer.slot = noIndex;
+      expireFn(timer.value);
+      // expireFn can't insert timers, so the reference is still valid
+      if (timer.period)
+      {
+        // Skip the periods missed while no worker was free
+        timer.deadline += timer.period * ((tick - timer.deadline) / timer.period + 1);
+        link(index);
+      }
+      else
+      {
+        release(index);
+        --_size;
+      }
+    }
+  }
+  if (tick > _currentTick)
+    _currentTick = tick;
+}
+
+template <typename T>
+inline std::vector<T> TimerWheel<T>::clear()
+{
+  std::vector<T> values{};
+  values.reserve(_size);
+  for (uint32_t index = 0; index < _timers.size(); ++index)
+    if (_timers[index].slot != noIndex)
+    {
+      unlink(index);
+      values.push_back(std::move(_timers[index].value));
+      release(index);
+    }
+  _size = 0;
+  return values;
+}
+
+template <typename T>
+inline uint32_t TimerWheel<T>::allocate(TimerTick deadline, TimerTick period, T&& value)
+{
+  if (_freeTimers.empty())
+  {
+    _timers.push_back({ deadline, period, noIndex, noIndex, noIndex, 0, std::move(value) });
+    return static_cast<uint32_t>(_timers.size() - 1);
+  }
+  auto index = _freeTimers.back();
+  _freeTimers.pop_back();
+  auto& timer = _timers[index];
+  timer.deadline = deadline;
+  timer.period = period;
+  timer.value = std::move(value);
+  return index;
+}
+
+template <typename T>
+inline void TimerWheel<T>::release(uint32_t index) noexcept
+{
+  auto& timer = _timers[index];
+  timer.value = T{};
+  ++timer.generation;
+  _freeTimers.push_back(index);
+}
+
+template <typename T>
+inline void TimerWheel<T>::link(uint32_t index) noexcept
+{
+  auto& timer = _timers[index];
+  auto differentBits = timer.deadline ^ _currentTick;
+  if (differentBits >> (levelCount * slotBits))
+    timer.slot = overflowSlot;
+  else
+  {
+    uint32_t level = 0;
+    while (differentBits >> ((level + 1) * slotBits))
+      ++level;
+    auto slot = slotIndex(timer.deadline, level);
+    timer.slot = level * slotCount + slot;
+    _slotMasks[level][slot / 64] |= uint64_t(1) << (slot % 64);
+  }
+  timer.prev = noIndex;
+  timer.next = _slots[timer.slot];
+  if (timer.next != noIndex)
+    _timers[timer.next].prev = index;
+  _slots[timer.slot] = index;
+}
+
+template <typename T>
+inline void TimerWheel<T>::unlink(uint32_t index) noexcept
+{
+  auto& timer = _timers[index];
+  if (timer.prev != noIndex)
+    _timers[timer.prev].next = timer.next;
+  else
+    _slots[timer.slot] = timer.next;
+  if (timer.next != noIndex)
+    _timers[timer.next].prev = timer.prev;
+  if ((_slots[timer.slot] == noIndex) && (timer.slot != overflowSlot))
+  {
+    auto slot = timer.slot % slotCount;
+    _slotMasks[timer.slot / slotCount][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+  }
+  timer.slot = noIndex;
+}
+
+template <typename T>
+inline uint32_t TimerWheel<T>::detach(uint32_t slot) noexcept
+{
+  auto index = _slots[slot];
+  _slots[slot] = noIndex;
+  if (slot != overflowSlot)
+    _slotMasks[slot / slotCount][(slot % slotCount) / 64] &= ~(uint64_t(1) << (slot % 64));
+  return index;
+}
+
+template <typename T>
+inline uint32_t TimerWheel<T>::firstSlot(uint32_t level, uint32_t from) const noexcept
+{
+  for (auto word = from / 64; word < maskWordCount; ++word)
+  {
+    auto bits = _slotMasks[level][word];
+    if (word == from / 64)
+      bits &= ~uint64_t(0) << (from % 64);
+    if (bits)
+      return word * 64 + firstBit(bits);
+  }
+  return noIndex;
+}
+
+#endif // TIMER_WHEEL_H
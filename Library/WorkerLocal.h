@@ -0,0 +1,63 @@
+#ifndef WORKER_LOCAL_H
+#define WORKER_LOCAL_H
+
+#include "TaskLauncher.h"
+
+#include <vector>
+
+// Value per worker of the launcher, so tasks accumulate into the slot of their worker without atomics or locks.
+// Slots are padded to a cache line, workers do not share them. Threads that are not workers of the launcher share
+// the last slot and must not use it concurrently. The slots are combined after the tasks are finished.
+template <typename T>
+class WorkerLocal
+{
+public:
+  explicit WorkerLocal(const TaskLauncher& launcher, const T& init = T{})
+    : _launcher{ launcher }
+    , _slots(launcher.threadCount() + 1, Slot{ init })
+    , _init{ init }
+  {
+  }
+
+  // Slot of the calling thread
+  T& local() noexcept { return _slots[_launcher.workerIndex()].value; }
+  T& local(ThreadCount workerIndex) noexcept { return _slots[workerIndex].value; }
+  const T& local(ThreadCount workerIndex) const noexcept { return _slots[workerIndex].value; }
+  auto slotCount() const noexcept { return _slots.size(); }
+
+  // Reduces the slots in the order of the workers
+  template <typename TCombineFn>
+  T combine(TCombineFn combineFn) const
+  {
+    auto result = _slots.front().value;
+    for (size_t slotIndex = 1; slotIndex < _slots.size(); ++slotIndex)
+      result = combineFn(result, _slots[slotIndex].value);
+    return result;
+  }
+
+  template <typename TFn>
+  void forEach(TFn fn) const
+  {
+    for (const auto& slot : _slots)
+      fn(slot.value);
+  }
+
+  void clear()
+  {
+    for (auto& slot : _slots)
+      slot.value = _init;
+  }
+
+private:
+  struct alignas(64) Slot
+  {
+    T value;
+  };
+
+private:
+  const TaskLauncher& _launcher;
+  std::vector<Slot> _slots;
+  T _init;
+};
+
+#endif // WORKER_LOCAL_H
@@ -11,6 +11,7 @@ void Keyboard::clearConsole()
 #ifdef _WIN32
 
 #include <SpinMutex.h>
+#include <atomic>
 #include <mutex>
 
 #include <Windows.h>
@@ -30,8 +31,26 @@ static bool setKeyModeFlag(HANDLE inputHandle, DWORD& mode, DWORD flag, bool on)
   return changed;
 }
 
-int Keyboard::getChar() noexcept
+ConsoleSize Keyboard::consoleSize() noexcept
 {
+  CONSOLE_SCREEN_BUFFER_INFO info{};
+  if (!::GetConsoleScreenBufferInfo(::GetStdHandle(STD_OUTPUT_HANDLE), &info))
+    return { 24, 80 };
+  return { static_cast<unsigned short>(info.srWindow.Bottom - info.srWindow.Top + 1), static_cast<unsigned short>(info.srWindow.Right - info.srWindow.Left + 1) };
+}
+
+static std::atomic<bool> isWokenUp{ false };
+
+static HANDLE wakeUpEvent()
+{
+  static HANDLE _wakeUpEvent{ ::CreateEvent(nullptr, FALSE, FALSE, nullptr) };
+  return _wakeUpEvent;
+}
+
+int Keyboard::getChar(int timeout) noexcept
+{
+  HANDLE handles[] = { ::GetStdHandle(STD_INPUT_HANDLE), wakeUpEvent() };
+  auto finishTime = ::GetTickCount64() + timeout;
   while (true)
   {
     {
@@ -39,7 +58,23 @@ int Keyboard::getChar() noexcept
       if (::_kbhit() > 0)
         return ::_getch_nolock();
     }
-    Sleep(100);
+    auto currentTime = ::GetTickCount64();
+    if ((timeout >= 0) && (currentTime >= finishTime))
+      return timeOutChar;
+    auto result = ::WaitForMultipleObjects(2, handles, FALSE, timeout < 0 ? INFINITE : static_cast<DWORD>(finishTime - currentTime));
+    if (result == WAIT_TIMEOUT)
+      return timeOutChar;
+    if (result == WAIT_OBJECT_0 + 1)
+    {
+      isWokenUp = false;
+      return wakeUpChar;
+    }
+    if (result != WAIT_OBJECT_0)
+      return EOF;
+    // The input is signalled by other console events as well, they are discarded not to wait on them again
+    std::unique_lock spinLock{ ioSpinLock() };
+    if (::_kbhit() == 0)
+      ::FlushConsoleInputBuffer(handles[0]);
   }
 }
 
@@ -49,10 +84,10 @@ void Keyboard::ungetChar(int ch) noexcept
   ::_ungetch_nolock(ch);
 }
 
-bool Keyboard::isPressed() noexcept
+void Keyboard::wakeUp() noexcept
 {
-  std::unique_lock spinLock{ ioSpinLock() };
-  return ::_kbhit() > 0;
+  if (!isWokenUp.exchange(true))
+    ::SetEvent(wakeUpEvent());
 }
 
 struct KeyboardMode
@@ -105,37 +140,143 @@ void Keyboard::lineInputOn() noexcept
 #else
 
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 #include <termios.h>
 #include <unistd.h>
 
-int Keyboard::getChar() noexcept
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+ConsoleSize Keyboard::consoleSize() noexcept
+{
+  winsize size{};
+  if ((::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) < 0) || !size.ws_row || !size.ws_col)
+    return { 24, 80 };
+  return { size.ws_row, size.ws_col };
+}
+
+// Wakes up getChar polling the input: eventfd on Linux, a self-pipe elsewhere
+struct WakeUpChannel
+{
+  WakeUpChannel()
+  {
+#ifdef __linux__
+    readHandle = writeHandle = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+    int handles[2]{ -1, -1 };
+    if (::pipe(handles) == 0)
+      for (auto handle : handles)
+        ::fcntl(handle, F_SETFL, ::fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+    readHandle = handles[0];
+    writeHandle = handles[1];
+#endif
+  }
+
+  ~WakeUpChannel()
+  {
+    ::close(readHandle);
+    if (writeHandle != readHandle)
+      ::close(writeHandle);
+  }
+
+  void notify() noexcept
+  {
+    // A single write per wake-up, the flag is reset by the reader
+    if (!isNotified.exchange(true))
+    {
+      uint64_t value{ 1 };
+      [[maybe_unused]] auto result = ::write(writeHandle, &value, sizeof(value));
+    }
+  }
+
+  void drain() noexcept
+  {
+    uint64_t value{};
+    while (::read(readHandle, &value, sizeof(value)) > 0)
+      ;
+    // Reset after reading, a wake-up skipped meanwhile is handled by the caller of getChar anyway
+    isNotified = false;
+  }
+
+  int readHandle;
+  int writeHandle;
+  std::atomic<bool> isNotified{ false };
+};
+
+static WakeUpChannel& wakeUpChannel()
+{
+  static WakeUpChannel _wakeUpChannel{};
+  return _wakeUpChannel;
+}
+
+// Characters returned to the input, read by the input thread only
+static std::vector<int>& ungotChars()
+{
+  static std::vector<int> _ungotChars{};
+  return _ungotChars;
+}
+
+int Keyboard::getChar(int timeout) noexcept
 {
+  if (auto& chars = ungotChars(); !chars.empty())
+  {
+    auto ch = chars.back();
+    chars.pop_back();
+    return ch;
+  }
+
   Keyboard kb{};
   kb.echoOff();
   kb.lineInputOff();
+  auto& channel = wakeUpChannel();
+  pollfd handles[] = { { STDIN_FILENO, POLLIN, 0 }, { channel.readHandle, POLLIN, 0 } };
+  auto finishTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
   while (true)
   {
-    if (auto ch = std::getc(stdin); ch != EOF)
-      return ch;
-    usleep(100000);
+    auto pollTimeout = timeout;
+    if (timeout >= 0)
+      pollTimeout = std::max<int>(std::chrono::ceil<std::chrono::milliseconds>(finishTime - std::chrono::steady_clock::now()).count(), 0);
+    if (auto result = ::poll(handles, 2, pollTimeout); result == 0)
+      return timeOutChar;
+    else if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return EOF;
+    }
+    if (handles[0].revents & (POLLIN | POLLHUP | POLLERR))
+    {
+      unsigned char ch{};
+      if (auto result = ::read(STDIN_FILENO, &ch, 1); result == 1)
+        return ch;
+      else if ((result == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+        return EOF;
+    }
+    if (handles[1].revents & POLLIN)
+    {
+      channel.drain();
+      return wakeUpChar;
+    }
   }
 }
 
 void Keyboard::ungetChar(int ch) noexcept
 {
-  std::ungetc(ch, stdin);
+  ungotChars().push_back(ch);
 }
 
-bool Keyboard::isPressed() noexcept
+void Keyboard::wakeUp() noexcept
 {
-  Keyboard kb{};
-  kb.lineInputOff();
-  if (auto ch = std::getc(stdin); ch != EOF)
-  {
-    std::ungetc(ch, stdin);
-    return true;
-  }
-  return false;
+  wakeUpChannel().notify();
 }
 
 struct KeyboardMode
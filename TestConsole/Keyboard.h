@@ -5,13 +5,28 @@
 
 struct KeyboardMode;
 
+struct ConsoleSize
+{
+  unsigned short rowCount;
+  unsigned short colCount;
+};
+
 class Keyboard
 {
 public:
+  // Returned by getChar when it is woken up by wakeUp or the timeout expires
+  static constexpr int wakeUpChar = -2;
+  static constexpr int timeOutChar = -3;
+
   static void clearConsole();
-  static int getChar() noexcept;
+  // The size of the terminal window, 24x80 if it is unknown
+  static ConsoleSize consoleSize() noexcept;
+  // Waits for a key press or a wake-up no longer than the timeout in milliseconds (-1 is infinite),
+  // returns EOF if the input is closed
+  static int getChar(int timeout = -1) noexcept;
   static void ungetChar(int ch) noexcept;
-  static bool isPressed() noexcept;
+  // Wakes up getChar, can be called from any thread. Wake-ups before getChar returns are coalesced.
+  static void wakeUp() noexcept;
 
 public:
   Keyboard();
@@ -0,0 +1,54 @@
+#include "Screen.h"
+
+#include <algorithm>
+#include <cstdio>
+
+static void moveCursor(std::string& output, size_t row, size_t col)
+{
+  output += "\033[" + std::to_string(row + 1) + ";" + std::to_string(col + 1) + "H";
+}
+
+void Screen::present(const std::string& frame)
+{
+  auto size = Keyboard::consoleSize();
+  auto rowCount = std::max<size_t>(size.rowCount, 2) - 1;
+
+  std::vector<std::string> lines{};
+  for (size_t first = 0; lines.size() < rowCount;)
+  {
+    auto last = std::min(frame.find('\n', first), frame.size());
+    lines.push_back(frame.substr(first, std::min<size_t>(last - first, size.colCount)));
+    if (last == frame.size())
+      break;
+    first = last + 1;
+  }
+
+  std::string output{};
+  if (!_isValid || (size.rowCount != _size.rowCount) || (size.colCount != _size.colCount))
+  {
+    output += "\033[2J";
+    _lines.clear();
+    _size = size;
+    _isValid = true;
+  }
+
+  // Changed lines are rewritten and erased to the end, the rest of the previous frame below is erased
+  for (size_t row = 0; row < lines.size(); ++row)
+    if ((row >= _lines.size()) || (_lines[row] != lines[row]))
+    {
+      moveCursor(output, row, 0);
+      output += lines[row] + "\033[K";
+    }
+  if (lines.size() < _lines.size())
+  {
+    moveCursor(output, lines.size(), 0);
+    output += "\033[J";
+  }
+  if (output.empty())
+    return;
+  moveCursor(output, lines.size() - 1, lines.back().size());
+
+  std::fwrite(output.data(), 1, output.size(), stdout);
+  std::fflush(stdout);
+  _lines = std::move(lines);
+}
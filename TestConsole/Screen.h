@@ -0,0 +1,30 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include "Keyboard.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// The last frame written to the console. Only the lines that differ from it are written again using cursor addressing,
+// lines beyond the terminal height are dropped.
+class Screen
+{
+public:
+  Screen() = default;
+
+  // The frame lines are separated by '\n', the cursor is left at the end of the last line
+  void present(const std::string& frame);
+  // The console was written bypassing the screen, the next frame is written completely
+  void invalidate() noexcept { _isValid = false; }
+  // Rows available for a frame, the last terminal row is kept free not to scroll on a new line
+  size_t rowCount() const noexcept { return std::max<size_t>(Keyboard::consoleSize().rowCount, 2) - 1; }
+
+private:
+  std::vector<std::string> _lines;
+  ConsoleSize _size{};
+  bool _isValid{ false };
+};
+
+#endif // SCREEN_H
@@ -2,12 +2,22 @@
 
 #include <stdexcept>
 
-TableModel::TableModel(const TableRow& headerTitles)
+std::string TableModel::toString(const TableData& data)
+{
+  if (auto value = std::get_if<std::string>(&data))
+    return *value;
+  if (auto value = std::get_if<long long>(&data))
+    return std::to_string(*value);
+  return std::to_string(std::get<double>(data));
+}
+
+TableModel::TableModel(const TableHeader& headerTitles)
   : _headerTitles{ headerTitles }
+  , _cells{}
 {
 }
 
-const TableData& TableModel::headerData(size_t col) const
+const std::string& TableModel::headerData(size_t col) const
 {
   if (col < colCount())
     return _headerTitles[col];
@@ -15,11 +25,11 @@ const TableData& TableModel::headerData(size_t col) const
     throw std::out_of_range("Invalid column number.");
 }
 
-bool TableModel::setData(size_t row, size_t col, const TableData& data)
+bool TableModel::setData(size_t row, size_t col, TableData data)
 {
   if ((row < rowCount()) && (col < colCount()))
   {
-    (*std::next(_rows.begin(), row))[col] = data;
+    _cells[row * colCount() + col] = std::move(data);
     return true;
   }
   return false;
@@ -28,7 +38,7 @@ bool TableModel::setData(size_t row, size_t col, const TableData& data)
 const TableData& TableModel::data(size_t row, size_t col) const
 {
   if ((row < rowCount()) && (col < colCount()))
-    return (*std::next(_rows.begin(), row))[col];
+    return _cells[row * colCount() + col];
   else
     throw std::out_of_range("Invalid row or column number.");
 }
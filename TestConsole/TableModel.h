@@ -1,34 +1,37 @@
 #ifndef TABLE_MODEL_H
 #define TABLE_MODEL_H
 
-#include <list>
-#include <memory>
 #include <string>
+#include <variant>
 #include <vector>
 
-using TableData = std::string;
-using TableRow = std::vector<TableData>;
+// Numeric cells are stored typed and formatted when they are drawn
+using TableData = std::variant<std::string, long long, double>;
+using TableHeader = std::vector<std::string>;
 
+// Cells are stored row by row in a single array
 class TableModel
 {
 public:
-  TableModel(const TableRow& headerTitles);
+  static std::string toString(const TableData& data);
+
+public:
+  TableModel(const TableHeader& headerTitles);
 
   auto colCount() const noexcept { return _headerTitles.size(); };
-  auto rowCount() const noexcept { return _rows.size(); };
-  auto begin() const noexcept { return _rows.begin(); }
-  auto end() const noexcept { return _rows.end(); }
+  auto rowCount() const noexcept { return colCount() ? _cells.size() / colCount() : 0; };
 
-  void appendRow() { _rows.push_back(TableRow(colCount())); }
-  void removeLastRow() { _rows.pop_back(); }
+  void appendRow() { _cells.resize(_cells.size() + colCount()); }
+  void removeLastRow() { _cells.resize(_cells.size() - colCount()); }
 
-  const TableData& headerData(size_t col) const;
-  bool setData(size_t row, size_t col, const TableData& data);
+  const std::string& headerData(size_t col) const;
+  bool setData(size_t row, size_t col, TableData data);
   const TableData& data(size_t row, size_t col) const;
+  std::string text(size_t row, size_t col) const { return toString(data(row, col)); }
 
 private:
-  TableRow _headerTitles;
-  std::list<TableRow> _rows;
+  TableHeader _headerTitles;
+  std::vector<TableData> _cells;
 };
 
 #endif // TABLE_MODEL_H
@@ -1,11 +1,10 @@
 #include "TestWidget.h"
 
-#include "Keyboard.h"
-
 #include <ArraySort.h>
 #include <TaskLauncher.h>
 #include <ThreadSafeQueue.h>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <variant>
@@ -17,12 +16,14 @@
 #define WN_ARR_SZ "ArraySize"
 #define WN_ARR_SZ_ERR "ArraySizeError"
 #define WN_SZ_INFO "SizesInfo"
+#define WN_TOP_CNT "TopCount"
+#define WN_TOP_CNT_ERR "TopCountError"
 
 using namespace std::placeholders;
 
 struct Event;
 
-using EventInfo = std::variant<SortTaskProgress, SortTaskInfo, SortTaskResult>;
+using EventInfo = std::variant<SortTaskInfo, SortTaskResult>;
 using EventQueue = ThreadSafeQueue<Event>;
 
 struct Event
@@ -38,21 +39,21 @@ struct Event
   static bool get(Event& event) { return queue().tryPop(event); }
   static void post(Event&& event)
   {
+    // Workers only queue the event and wake up the input loop, the terminal is accessed by the main thread
     queue().push(std::move(event));
-    if (!Widget::hasInput())
-      Widget::ungetInput(WidgetInput::REFRESH);
+    Widget::refresh();
   }
 
   static void postEnd(TaskId taskId, const SortTaskResult& result) { post({ taskId, { result } }); }
   static void postStart(TaskId taskId, ThreadId threadId, size_t begin, size_t end) { post({ taskId, SortTaskInfo{ threadId, { begin, end } } }); }
-  static void postProgress(TaskId taskId, double progress) { post({ taskId, { progress } }); }
 };
 
-TestWidget::TestWidget()
+TestWidget::TestWidget(const std::string& arrayFilePath)
   : ComposedWidget(WN_MAIN)
   , _taskLauncherInfo{ { "Id", "Thread Id", "Array Index Range", "Progress", "Result" } }
   , _sizesInfo{ { "Thread Pool Size", "Array Size" } }
-  , _arraySort{ Event::postStart, Event::postProgress, Event::postEnd }
+  , _arraySort{ Event::postStart, Event::postEnd, std::thread::hardware_concurrency(), arrayFilePath }
+  , _runningRows{}
 {
   _sizesInfo.appendRow();
 
@@ -64,74 +65,80 @@ TestWidget::TestWidget()
 
 void TestWidget::draw()
 {
-  _sizesInfo.setData(0, SI_THREAD_POOL, std::to_string(_arraySort.threadCount()));
-  _sizesInfo.setData(0, SI_ARRAY, std::to_string(_arraySort.arraySize()));
-  childWidget<TableWidget>(WN_SZ_INFO)->adjustWidth();
+  _sizesInfo.setData(0, SI_THREAD_POOL, static_cast<long long>(_arraySort.threadCount()));
+  _sizesInfo.setData(0, SI_ARRAY, static_cast<long long>(_arraySort.arraySize()));
 
   Event event{};
   while (Event::get(event))
   {
+    if (!_arraySort.isBatchTask(event.taskId))
+      continue; // the task of a previous sort
     if (std::holds_alternative<SortTaskInfo>(event.info))
     {
       auto& taskInfo = std::get<SortTaskInfo>(event.info);
       auto& threadId = taskInfo.first;
       auto& taskRange = taskInfo.second;
 
-      auto row = _arraySort.saveTask(event.taskId);
+      auto row = _arraySort.taskIndex(event.taskId);
+      _runningRows.push_back(row);
       while (_taskLauncherInfo.rowCount() <= row)
         _taskLauncherInfo.appendRow();
 
-      _taskLauncherInfo.setData(row, TLI_ID, std::to_string(event.taskId));
+      _taskLauncherInfo.setData(row, TLI_ID, event.taskId);
       _taskLauncherInfo.setData(row, TLI_THREAD_ID, ArraySort::threadIdToStr(threadId));
       _taskLauncherInfo.setData(row, TLI_INFO, "[" + std::to_string(taskRange.first) + ", " + std::to_string(taskRange.second) + ")");
-      _taskLauncherInfo.setData(row, TLI_PROGRESS, std::to_string(0.0));
+      _taskLauncherInfo.setData(row, TLI_PROGRESS, 0.0);
       _taskLauncherInfo.setData(row, TLI_RESULT, "");
-
-      childWidget<TableWidget>(WN_TASK_INFO)->adjustWidth();
-    }
-    else if (std::holds_alternative<SortTaskProgress>(event.info) && _arraySort.isTaskSaved(event.taskId))
-    {
-      auto& taskInfo = std::get<SortTaskProgress>(event.info);
-      auto row = _arraySort.taskIndex(event.taskId);
-      if (row < _taskLauncherInfo.rowCount())
-      {
-        _taskLauncherInfo.setData(row, TLI_PROGRESS, std::to_string(taskInfo));
-        childWidget<TableWidget>(WN_TASK_INFO)->adjustWidth();
-      }
     }
-    else if (std::holds_alternative<SortTaskResult>(event.info) && _arraySort.isTaskSaved(event.taskId))
+    else
     {
       auto& taskInfo = std::get<SortTaskResult>(event.info);
-      auto row = _arraySort.finishTask(event.taskId);
+      auto row = _arraySort.taskIndex(event.taskId);
+      _runningRows.erase(std::remove(_runningRows.begin(), _runningRows.end(), row), _runningRows.end());
       if (row < _taskLauncherInfo.rowCount())
       {
         try
         {
           auto& taskResult = taskInfo.get();
-          _taskLauncherInfo.setData(row, TLI_PROGRESS, std::to_string(1.0));
+          _taskLauncherInfo.setData(row, TLI_PROGRESS, 1.0);
           _taskLauncherInfo.setData(row, TLI_RESULT, taskResult);
         }
         catch (const std::runtime_error& e)
         {
           _taskLauncherInfo.setData(row, TLI_RESULT, e.what());
         }
-        childWidget<TableWidget>(WN_TASK_INFO)->adjustWidth();
       }
     }
   }
 
+  // The progress of running tasks is sampled every frame while they run
+  for (auto row : _runningRows)
+    _taskLauncherInfo.setData(row, TLI_PROGRESS, _arraySort.taskProgress(row));
+  Widget::setContinuousRefresh(!_runningRows.empty());
+
+  // Task rows that do not fit the terminal are not drawn: the free space is left by the widgets around the task table
+  auto taskInfoIt = child(WN_TASK_INFO);
+  auto taskInfo = static_cast<TableWidget*>(taskInfoIt->get());
+  auto head = render(firstChild(), taskInfoIt);
+  auto tail = render(std::next(taskInfoIt), endChild());
+  auto frameRowCount = static_cast<size_t>(std::count(head.begin(), head.end(), '\n') + std::count(tail.begin(), tail.end(), '\n')) +
+    taskInfo->frameRowCount() + 1;
+  taskInfo->setMaxRowCount(_screen.rowCount() > frameRowCount ? _screen.rowCount() - frameRowCount : 0);
+  _screen.present(head + render(taskInfoIt, std::next(taskInfoIt)) + tail);
+}
+
+std::string TestWidget::render(WidgetCIt first, WidgetCIt last)
+{
   std::ostringstream local{};
   auto coutBuff = std::cout.rdbuf();
   std::cout.rdbuf(local.rdbuf());
 
-  Keyboard::clearConsole();
-  ComposedWidget::draw();
+  for (; first != last; ++first)
+    (*first)->draw();
 
   std::cout << std::flush;
   std::cout.rdbuf(coutBuff);
-
-  std::printf("%s", local.str().c_str());
-  std::fflush(stdout);
+  return local.str();
 }
 
 std::unique_ptr<Widget> TestWidget::createWidget(const std::string& name)
@@ -145,15 +152,25 @@ std::unique_ptr<Widget> TestWidget::createWidget(const std::string& name)
   else if (name == WN_CMD)
     return std::make_unique<ActionWidget>(name, "Type:",
       ActionWidget::Actions{ { '1', "To resize and generate input array", std::bind(&TestWidget::readArraySize, this) },
-        { '2', "To start/stop sorting", std::bind(&TestWidget::startStop, this) }, { WidgetInput::ESC, "To exit", {} } });
+        { '2', "To start/stop sorting", [this]() { startStop(); } },
+        { '3', "To start/stop selecting the greatest values", std::bind(&TestWidget::readTopCount, this) },
+        { '4', "To start/stop the median split", [this]() { startStop(SortOperation::NTH_ELEMENT, _arraySort.arraySize() / 2); } },
+        { '5', "To start/stop generating and sorting by cache-sized parts", std::bind(&TestWidget::startStopFused, this) },
+        { WidgetInput::ESC, "To exit", {} } });
   else if (name == WN_ARR_SZ)
     return std::make_unique<InputWidget>(name,
       "Enter the size of the array [" + std::to_string(ArraySort::minArraySize(_arraySort.threadCount())) + ", " +
-        std::string(std::to_string(ArraySort::maxArraySize())) + "]: ",
+        std::string(std::to_string(_arraySort.maxStorageArraySize())) + "]: ",
       "[\\d]+", std::bind(&TestWidget::setArraySize, this, _1));
   else if (name == WN_ARR_SZ_ERR)
     return std::make_unique<ActionWidget>(
       name, "Incorrect array size!", ActionWidget::Actions{ { WidgetInput::NO_INPUT, "", [this]() { removeChild(WN_ARR_SZ_ERR); } } });
+  else if (name == WN_TOP_CNT)
+    return std::make_unique<InputWidget>(name, "Enter the number of the greatest values [1, " + std::to_string(_arraySort.arraySize()) + "]: ", "[\\d]+",
+      std::bind(&TestWidget::setTopCount, this, _1));
+  else if (name == WN_TOP_CNT_ERR)
+    return std::make_unique<ActionWidget>(
+      name, "Incorrect number of values!", ActionWidget::Actions{ { WidgetInput::NO_INPUT, "", [this]() { removeChild(WN_TOP_CNT_ERR); } } });
   else
     return std::unique_ptr<Widget>{};
 }
@@ -163,10 +180,34 @@ void TestWidget::readArraySize()
   pushChild(createWidget(WN_ARR_SZ));
 }
 
-void TestWidget::startStop()
+void TestWidget::readTopCount()
 {
+  // Running tasks are interrupted without asking the count
   if (_arraySort.areAllTasksFinished())
-    _arraySort.sort();
+    pushChild(createWidget(WN_TOP_CNT));
+  else
+    _arraySort.interrupt();
+}
+
+void TestWidget::startStop(SortOperation operation, size_t count)
+{
+  if (_arraySort.areAllTasksFinished())
+  {
+    // Rows of the previous sort are reused by the tasks of the new one
+    _runningRows.clear();
+    _arraySort.select(operation, count);
+  }
+  else
+    _arraySort.interrupt();
+}
+
+void TestWidget::startStopFused()
+{
+  if (_arraySort.areAllTasksFinished())
+  {
+    _runningRows.clear();
+    _arraySort.generateAndSort(_arraySort.arraySize());
+  }
   else
     _arraySort.interrupt();
 }
@@ -176,12 +217,24 @@ void TestWidget::setArraySize(const std::string& value)
   size_t size;
   std::stringstream{ value } >> size;
   removeChild(child(WN_ARR_SZ));
-  if ((_arraySort.minArraySize() <= size) && (size <= ArraySort::maxArraySize()))
+  if ((_arraySort.minArraySize() <= size) && (size <= _arraySort.maxStorageArraySize()))
   {
     std::printf("%s", "Array generation! Please wait!\n");
     std::fflush(stdout);
+    _screen.invalidate();
     _arraySort.generateArray(size);
   }
   else
     pushChild(createWidget(WN_ARR_SZ_ERR));
 }
+
+void TestWidget::setTopCount(const std::string& value)
+{
+  size_t count;
+  std::stringstream{ value } >> count;
+  removeChild(child(WN_TOP_CNT));
+  if ((1 <= count) && (count <= _arraySort.arraySize()))
+    startStop(SortOperation::TOP_K, count);
+  else
+    pushChild(createWidget(WN_TOP_CNT_ERR));
+}
@@ -3,6 +3,7 @@
 
 #include "Widget.h"
 
+#include "Screen.h"
 #include "TableModel.h"
 
 #include <ArraySort.h>
@@ -14,21 +15,30 @@ class TestWidget : public ComposedWidget
   enum : size_t { SI_THREAD_POOL, SI_ARRAY, _SI_COUNT };
   // clang-format on
 public:
-  TestWidget();
+  // Arrays are generated in the given file if it is not empty
+  TestWidget(const std::string& arrayFilePath = {});
 
   void draw() override;
 
 protected:
   std::unique_ptr<Widget> createWidget(const std::string& name);
+  // Draws the children to a string
+  std::string render(WidgetCIt first, WidgetCIt last);
 
   void readArraySize();
-  void startStop();
+  void readTopCount();
+  void startStop(SortOperation operation = SortOperation::SORT, size_t count = 0);
+  // Regenerates the array of the current size, every part is sorted right after its generation
+  void startStopFused();
   void setArraySize(const std::string& value);
+  void setTopCount(const std::string& value);
 
 public:
   TableModel _taskLauncherInfo;
   TableModel _sizesInfo;
   ArraySort _arraySort;
+  std::vector<SortTaskIndex> _runningRows;
+  Screen _screen;
 };
 
 #endif // WIDGET_H
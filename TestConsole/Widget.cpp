@@ -3,15 +3,61 @@
 #include "Keyboard.h"
 #include "TableModel.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <regex>
 #include <set>
 #include <stdexcept>
 
+struct RefreshState
+{
+  using Clock = std::chrono::steady_clock;
+
+  Clock::duration frameInterval{ std::chrono::milliseconds(1000) / 30 };
+  Clock::time_point refreshTime{};
+  bool isRefreshPending{ false };
+  bool isContinuous{ false };
+};
+
+static RefreshState& refreshState()
+{
+  static RefreshState _refreshState{};
+  return _refreshState;
+}
+
 int Widget::getInput() noexcept
 {
-  return Keyboard::getChar();
+  auto& state = refreshState();
+  while (true)
+  {
+    // A pending refresh is delayed until the next frame, a continuous one is not faster than a millisecond
+    auto timeout = -1;
+    if (state.isRefreshPending || state.isContinuous)
+      timeout = std::max<int>(
+        std::chrono::ceil<std::chrono::milliseconds>(state.refreshTime + state.frameInterval - RefreshState::Clock::now()).count(),
+        state.isRefreshPending ? 0 : 1);
+
+    auto input = Keyboard::getChar(timeout);
+    if ((input == Keyboard::wakeUpChar) || (input == Keyboard::timeOutChar))
+    {
+      auto now = RefreshState::Clock::now();
+      if ((input == Keyboard::timeOutChar) || (now >= state.refreshTime + state.frameInterval))
+      {
+        state.isRefreshPending = false;
+        state.refreshTime = now;
+        return WidgetInput::REFRESH;
+      }
+      state.isRefreshPending = true;
+    }
+    else
+      // The closed input exits
+      return input == EOF ? WidgetInput::ESC : input;
+  }
 }
 
 void Widget::ungetInput(int ch) noexcept
@@ -19,9 +65,20 @@ void Widget::ungetInput(int ch) noexcept
   Keyboard::ungetChar(ch);
 }
 
-bool Widget::hasInput() noexcept
+void Widget::refresh() noexcept
 {
-  return Keyboard::isPressed();
+  Keyboard::wakeUp();
+}
+
+void Widget::setContinuousRefresh(bool isOn) noexcept
+{
+  refreshState().isContinuous = isOn;
+}
+
+void Widget::setFrameRate(unsigned frameRate) noexcept
+{
+  refreshState().frameInterval =
+    frameRate ? std::chrono::duration_cast<RefreshState::Clock::duration>(std::chrono::seconds(1)) / frameRate : RefreshState::Clock::duration::zero();
 }
 
 std::string Widget::inputToStr(int input)
@@ -73,15 +130,29 @@ WidgetIt ComposedWidget::pushChild(std::unique_ptr<Widget>&& child)
 TableWidget::TableWidget(const std::string& name, const std::string& title, TableModel* model)
   : Widget(name)
   , _model(model)
+  , _title{ title }
   , _colWidths(_model ? _model->colCount() : 0)
+  , _maxRowCount{ std::numeric_limits<size_t>::max() }
 {
-  adjustWidth();
+  for (size_t colIndex = 0; colIndex < _colWidths.size(); ++colIndex)
+    _colWidths[colIndex] = _model->headerData(colIndex).size();
 }
 
 void TableWidget::draw()
 {
   if (_model)
   {
+    // Only the drawn rows are formatted, the column widths grow to fit them
+    auto rowCount = std::min(_model->rowCount(), _maxRowCount);
+    std::vector<std::string> texts(rowCount * _model->colCount());
+    for (size_t rowIndex = 0; rowIndex < rowCount; ++rowIndex)
+      for (size_t colIndex = 0; colIndex < _model->colCount(); ++colIndex)
+      {
+        auto& text = texts[rowIndex * _model->colCount() + colIndex] = _model->text(rowIndex, colIndex);
+        if (_colWidths[colIndex] < text.size())
+          _colWidths[colIndex] = text.size();
+      }
+
     auto colSepLen = std::strlen(colSep);
     auto colTotalWidth = colSepLen;
 
@@ -99,28 +170,17 @@ void TableWidget::draw()
     std::cout << std::endl << std::left << std::setw(colTotalWidth) << std::setfill('-') << "" << std::endl;
 
     // Data
-    for (const auto& row : *_model)
+    for (size_t rowIndex = 0; rowIndex < rowCount; ++rowIndex)
     {
       std::cout << colSep;
       for (size_t colIndex = 0; colIndex < _model->colCount(); ++colIndex)
-        std::cout << std::left << std::setw(_colWidths[colIndex]) << std::setfill(' ') << row[colIndex] << colSep;
+        std::cout << std::left << std::setw(_colWidths[colIndex]) << std::setfill(' ') << texts[rowIndex * _model->colCount() + colIndex] << colSep;
       std::cout << std::endl;
     }
-    std::cout << std::left << std::setw(colTotalWidth) << std::setfill('-') << "" << std::endl << std::endl;
-  }
-}
-
-void TableWidget::adjustWidth()
-{
-  if (_model)
-  {
-    _colWidths.resize(_model->colCount());
-    for (size_t colIndex = 0; colIndex < _model->colCount(); ++colIndex)
-      _colWidths[colIndex] = _model->headerData(colIndex).size();
-    for (const auto& row : *_model)
-      for (size_t colIndex = 0; colIndex < row.size(); ++colIndex)
-        if (_colWidths[colIndex] < row[colIndex].size())
-          _colWidths[colIndex] = row[colIndex].size();
+    std::cout << std::left << std::setw(colTotalWidth) << std::setfill('-') << "" << std::endl;
+    if (rowCount < _model->rowCount())
+      std::cout << "(" << _model->rowCount() - rowCount << " more rows)";
+    std::cout << std::endl;
   }
 }
 
@@ -135,7 +195,7 @@ InputWidget::InputWidget(const std::string& name, const std::string& title, cons
 
 void InputWidget::draw()
 {
-  std::cout << _title;
+  std::cout << _title << _value;
 }
 
 int InputWidget::execute()
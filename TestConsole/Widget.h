@@ -21,7 +21,12 @@ class Widget
 public:
   static int getInput() noexcept;
   static void ungetInput(int ch) noexcept;
-  static bool hasInput() noexcept;
+  // Makes getInput return REFRESH, can be called from any thread
+  static void refresh() noexcept;
+  // Refreshes are returned no more often than the frame rate, key presses at once. 0 is unlimited.
+  static void setFrameRate(unsigned frameRate) noexcept;
+  // While on, getInput returns REFRESH every frame to sample changing data
+  static void setContinuousRefresh(bool isOn) noexcept;
   static std::string inputToStr(int res);
 
 public:
@@ -113,12 +118,16 @@ public:
   void draw() override;
   int execute() override { return WidgetInput::NO_INPUT; }
 
-  void adjustWidth();
+  // Rows beyond the limit are not drawn, only their count is
+  void setMaxRowCount(size_t maxRowCount) noexcept { _maxRowCount = maxRowCount; }
+  // Lines drawn besides the data rows
+  size_t frameRowCount() const noexcept { return _model ? (_title.empty() ? 4 : 5) : 0; }
 
 private:
   TableModel* _model;
   std::string _title;
-  std::vector<uint16_t> _colWidths;
+  std::vector<size_t> _colWidths;
+  size_t _maxRowCount;
 };
 
 class InfoWidget : public Widget
@@ -1,16 +1,47 @@
 #include "TestWidget.h"
 
+#include <TaskTracer.h>
+
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <string>
 
 int main(int argc, char* argv[])
 {
-  TestWidget testWidget{};
+  // The execution trace is dumped into the file given by the environment variable
+  auto traceFileName = std::getenv("TASKQUEUE_TRACE");
+  if (traceFileName)
+    TaskTracer::start();
+
+  // TestConsole [--fps N] [--file PATH]
+  // Redraws on task events are limited by the frame rate, arrays are sorted in the file (external sort) if it is given
+  std::string arrayFilePath{};
+  for (int argIndex = 1; argIndex + 1 < argc; argIndex += 2)
+  {
+    std::string arg{ argv[argIndex] };
+    if (arg == "--fps")
+      Widget::setFrameRate(std::strtoul(argv[argIndex + 1], nullptr, 10));
+    else if (arg == "--file")
+      arrayFilePath = argv[argIndex + 1];
+  }
+
+  {
+    TestWidget testWidget{ arrayFilePath };
+
+    while (true)
+    {
+      testWidget.draw();
+      if (testWidget.execute() == WidgetInput::ESC)
+        break;
+    }
+  }
 
-  while (true)
+  if (traceFileName)
   {
-    testWidget.draw();
-    if (testWidget.execute() == WidgetInput::ESC)
-      break;
+    TaskTracer::stop();
+    std::ofstream traceFile{ traceFileName };
+    TaskTracer::dump(traceFile);
   }
 
   return 0;
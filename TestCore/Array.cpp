@@ -0,0 +1,156 @@
+#include "Array.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+Array::Array(size_t size)
+  : _buffer{ ArrayBufferPool::pool().acquire(size) }
+  , _filePath{}
+  , _data{ _buffer.data }
+  , _size{ size }
+{
+}
+
+Array::Array(const std::string& filePath, size_t size)
+  : _buffer{}
+  , _filePath{ filePath }
+  , _data{ nullptr }
+  , _size{ 0 }
+{
+  map(size);
+}
+
+Array::~Array()
+{
+  unmap();
+  if (_buffer.data)
+    ArrayBufferPool::pool().release(std::move(_buffer));
+}
+
+void Array::replaceFile(const std::string& filePath)
+{
+  auto size = _size;
+  unmap();
+  // The array is empty while no file is mapped, so a failure never leaves its size over a null pointer
+  _size = 0;
+  try
+  {
+    std::filesystem::rename(filePath, _filePath);
+  }
+  catch (...)
+  {
+    // The original file is mapped back, the error of the rename is reported even if it can't be
+    try
+    {
+      map(size);
+    }
+    catch (...)
+    {
+    }
+    throw;
+  }
+  map(size);
+}
+
+void Array::swap(Array& other) noexcept
+{
+  std::swap(_buffer, other._buffer);
+  _filePath.swap(other._filePath);
+  std::swap(_data, other._data);
+  std::swap(_size, other._size);
+#ifdef WIN32
+  std::swap(_mapping, other._mapping);
+#endif
+}
+
+#ifdef WIN32
+void Array::map(size_t size)
+{
+  auto file = ::CreateFileA(_filePath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::system_error{ static_cast<int>(::GetLastError()), std::system_category(), "Can't open " + _filePath };
+  LARGE_INTEGER byteCount{};
+  byteCount.QuadPart = static_cast<LONGLONG>(size * sizeof(ArrayValue));
+  auto isMapped = ::SetFilePointerEx(file, byteCount, nullptr, FILE_BEGIN) && ::SetEndOfFile(file);
+  if (isMapped && size)
+  {
+    _mapping = ::CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    _data = _mapping ? static_cast<ArrayValue*>(::MapViewOfFile(_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0)) : nullptr;
+    isMapped = _data != nullptr;
+  }
+  auto error = static_cast<int>(::GetLastError());
+  ::CloseHandle(file);
+  if (!isMapped)
+  {
+    unmap();
+    throw std::system_error{ error, std::system_category(), "Can't map " + _filePath };
+  }
+  _size = size;
+}
+
+void Array::unmap() noexcept
+{
+  if (_data && isMapped())
+    ::UnmapViewOfFile(_data);
+  if (_mapping)
+    ::CloseHandle(_mapping);
+  _mapping = nullptr;
+  if (isMapped())
+    _data = nullptr;
+}
+
+void Array::advise(ArrayAccess, size_t, size_t) const noexcept
+{
+  // The system read-ahead is not tuned on Windows
+}
+#else
+void Array::map(size_t size)
+{
+  auto file = ::open(_filePath.c_str(), O_RDWR | O_CREAT, 0644);
+  if (file < 0)
+    throw std::system_error{ errno, std::generic_category(), "Can't open " + _filePath };
+  auto byteCount = size * sizeof(ArrayValue);
+  void* data{ nullptr };
+  if (::ftruncate(file, static_cast<off_t>(byteCount)))
+    data = MAP_FAILED;
+  else if (size) // an empty file can't be mapped
+    data = ::mmap(nullptr, byteCount, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+  auto error = errno;
+  ::close(file);
+  if (data == MAP_FAILED)
+    throw std::system_error{ error, std::generic_category(), "Can't map " + _filePath };
+  _data = static_cast<ArrayValue*>(data);
+  _size = size;
+}
+
+void Array::unmap() noexcept
+{
+  if (_data && isMapped())
+  {
+    ::munmap(_data, _size * sizeof(ArrayValue));
+    _data = nullptr;
+  }
+}
+
+void Array::advise(ArrayAccess access, size_t from, size_t to) const noexcept
+{
+  static const auto pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+  static constexpr int advices[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED };
+  to = std::min(to, _size);
+  if (!isMapped() || !_data || (from >= to))
+    return;
+  // The range is extended to the page boundary, the hint is ignored on failure
+  auto first = reinterpret_cast<uintptr_t>(_data + from) & ~(pageSize - 1);
+  auto last = reinterpret_cast<uintptr_t>(_data + to);
+  ::madvise(reinterpret_cast<void*>(first), last - first, advices[access]);
+}
+#endif
@@ -0,0 +1,74 @@
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#include "ArrayBuffer.h"
+
+#include <string>
+
+// clang-format off
+struct _ArrayAccess { enum ArrayAccess : char { NORMAL, SEQUENTIAL, RANDOM, WILL_NEED, DONT_NEED }; };
+// clang-format on
+using ArrayAccess = _ArrayAccess::ArrayAccess;
+
+// Contiguous values kept in memory or in a memory-mapped file, so arrays larger than the memory can be sorted.
+// The memory is taken from the buffer pool and returned to it.
+class Array
+{
+public:
+  using value_type = ArrayValue;
+  using iterator = ArrayValue*;
+  using const_iterator = const ArrayValue*;
+
+public:
+  Array() noexcept = default;
+  // Values are not initialized
+  explicit Array(size_t size);
+  // Maps the file resized to the given size, the file is created if necessary and kept after unmapping
+  Array(const std::string& filePath, size_t size);
+  ~Array();
+
+  Array(Array&& other) noexcept { swap(other); }
+  Array& operator=(Array&& other) noexcept
+  {
+    Array{ std::move(other) }.swap(*this);
+    return *this;
+  }
+  Array(const Array&) = delete;
+  Array& operator=(const Array&) = delete;
+
+  auto size() const noexcept { return _size; }
+  auto empty() const noexcept { return !_size; }
+  ArrayValue* data() noexcept { return _data; }
+  const ArrayValue* data() const noexcept { return _data; }
+  iterator begin() noexcept { return _data; }
+  iterator end() noexcept { return _data + _size; }
+  const_iterator begin() const noexcept { return _data; }
+  const_iterator end() const noexcept { return _data + _size; }
+  ArrayValue& operator[](size_t index) noexcept { return _data[index]; }
+  const ArrayValue& operator[](size_t index) const noexcept { return _data[index]; }
+
+  // Empty for an array in memory
+  const std::string& filePath() const noexcept { return _filePath; }
+  bool isMapped() const noexcept { return !_filePath.empty(); }
+  // Hint about the coming access to [from, to), ignored for an array in memory
+  void advise(ArrayAccess access, size_t from, size_t to) const noexcept;
+  // Maps the given file of the same size instead of the array file, which is replaced by it. If the rename fails,
+  // the array file is mapped back and the error is rethrown.
+  void replaceFile(const std::string& filePath);
+  void swap(Array& other) noexcept;
+
+private:
+  void map(size_t size);
+  void unmap() noexcept;
+
+private:
+  ArrayBuffer _buffer{};
+  std::string _filePath{};
+  ArrayValue* _data{ nullptr };
+  size_t _size{ 0 };
+#ifdef WIN32
+  void* _mapping{ nullptr };
+#endif
+};
+
+#endif // ARRAY_H
@@ -0,0 +1,131 @@
+#include "ArrayBuffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static size_t roundUp(size_t value, size_t alignment) noexcept
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+ArrayBuffer ArrayBufferPool::acquire(size_t size)
+{
+  auto byteCount = std::max<size_t>(size, 1) * sizeof(ArrayValue);
+  std::vector<ArrayBuffer> buffers{};
+  {
+    std::unique_lock spinLock{ _isBusy };
+    auto buffer = std::find_if(_buffers.begin(), _buffers.end(),
+      [byteCount](const ArrayBuffer& buffer) { return (byteCount <= buffer.byteCount) && (buffer.byteCount / 2 < byteCount); });
+    if (buffer != _buffers.end())
+    {
+      auto result = *buffer;
+      _buffers.erase(buffer);
+      return result;
+    }
+    buffers.swap(_buffers);
+  }
+  // The kept buffers are freed before allocating, so they do not add to the peak memory
+  for (auto& buffer : buffers)
+    free(buffer);
+  return allocate(byteCount + byteCount / 8);
+}
+
+void ArrayBufferPool::release(ArrayBuffer&& buffer)
+{
+  std::unique_lock spinLock{ _isBusy };
+  _buffers.push_back(buffer);
+  buffer = {};
+}
+
+void ArrayBufferPool::clear() noexcept
+{
+  std::vector<ArrayBuffer> buffers{};
+  {
+    std::unique_lock spinLock{ _isBusy };
+    buffers.swap(_buffers);
+  }
+  for (auto& buffer : buffers)
+    free(buffer);
+}
+
+size_t ArrayBufferPool::bufferCount() const noexcept
+{
+  std::unique_lock spinLock{ _isBusy };
+  return _buffers.size();
+}
+
+#ifdef WIN32
+ArrayBuffer ArrayBufferPool::allocate(size_t byteCount)
+{
+  // Large pages need the "Lock pages in memory" privilege
+  if (auto largePageSize = ::GetLargePageMinimum(); largePageSize && (byteCount >= largePageSize))
+  {
+    auto largeByteCount = roundUp(byteCount, largePageSize);
+    auto data = ::VirtualAlloc(nullptr, largeByteCount, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (data)
+      return { static_cast<ArrayValue*>(data), largeByteCount, true };
+  }
+  // The allocation granularity
+  byteCount = roundUp(byteCount, size_t{ 1 } << 16);
+  auto data = ::VirtualAlloc(nullptr, byteCount, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  if (!data)
+    throw std::bad_alloc{};
+  return { static_cast<ArrayValue*>(data), byteCount, false };
+}
+
+void ArrayBufferPool::free(ArrayBuffer& buffer) noexcept
+{
+  if (buffer.data)
+    ::VirtualFree(buffer.data, 0, MEM_RELEASE);
+  buffer = {};
+}
+#else
+ArrayBuffer ArrayBufferPool::allocate(size_t byteCount)
+{
+  static const auto pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  if (byteCount < hugePageSize)
+  {
+    byteCount = roundUp(byteCount, pageSize);
+    auto data = ::mmap(nullptr, byteCount, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+      throw std::bad_alloc{};
+    return { static_cast<ArrayValue*>(data), byteCount, false };
+  }
+
+  byteCount = roundUp(byteCount, hugePageSize);
+  // Explicit huge pages are reserved by vm.nr_hugepages
+  auto data = ::mmap(nullptr, byteCount, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (data != MAP_FAILED)
+    return { static_cast<ArrayValue*>(data), byteCount, true };
+
+  // Transparent huge pages need the mapping aligned to the huge page size, the unaligned ends are unmapped
+  data = ::mmap(nullptr, byteCount + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED)
+    throw std::bad_alloc{};
+  auto first = reinterpret_cast<uintptr_t>(data);
+  auto alignedFirst = roundUp(first, hugePageSize);
+  if (alignedFirst != first)
+    ::munmap(data, alignedFirst - first);
+  ::munmap(reinterpret_cast<void*>(alignedFirst + byteCount), first + hugePageSize - alignedFirst);
+  data = reinterpret_cast<void*>(alignedFirst);
+  // Fails if transparent huge pages are disabled, the regular pages are used then
+  auto isHuge = !::madvise(data, byteCount, MADV_HUGEPAGE);
+  return { static_cast<ArrayValue*>(data), byteCount, isHuge };
+}
+
+void ArrayBufferPool::free(ArrayBuffer& buffer) noexcept
+{
+  if (buffer.data)
+    ::munmap(buffer.data, buffer.byteCount);
+  buffer = {};
+}
+#endif
@@ -0,0 +1,57 @@
+#ifndef ARRAY_BUFFER_H
+#define ARRAY_BUFFER_H
+
+#include <SpinMutex.h>
+
+#include <cstddef>
+#include <vector>
+
+using ArrayValue = int;
+
+// Anonymous memory of array values, backed by huge pages if the system allows it
+struct ArrayBuffer
+{
+  ArrayValue* data{ nullptr };
+  size_t byteCount{ 0 };
+  bool isHuge{ false };
+
+  size_t capacity() const noexcept { return byteCount / sizeof(ArrayValue); }
+};
+
+// Released buffers are kept for arrays of a similar size, so regenerating an array reuses the memory
+// without faulting its pages in again
+class ArrayBufferPool
+{
+public:
+  // Huge page size of x86-64 and AArch64 with 4 KiB pages
+  static constexpr size_t hugePageSize = size_t{ 2 } << 20;
+
+  static ArrayBufferPool& pool()
+  {
+    static ArrayBufferPool _pool{};
+    return _pool;
+  }
+
+public:
+  ~ArrayBufferPool() { clear(); }
+
+  // A kept buffer is reused if the size takes more than half of it, otherwise the kept buffers are freed and a new one
+  // is allocated with a growth reserve. Values of a reused buffer are not cleared.
+  ArrayBuffer acquire(size_t size);
+  void release(ArrayBuffer&& buffer);
+  void clear() noexcept;
+  size_t bufferCount() const noexcept;
+
+private:
+  ArrayBufferPool() = default;
+
+  // Explicit huge pages if they are reserved, otherwise transparent huge pages if they are enabled, otherwise regular pages
+  static ArrayBuffer allocate(size_t byteCount);
+  static void free(ArrayBuffer& buffer) noexcept;
+
+private:
+  mutable SpinMutex _isBusy;
+  std::vector<ArrayBuffer> _buffers;
+};
+
+#endif // ARRAY_BUFFER_H
@@ -1,13 +1,20 @@
 #include "ArraySort.h"
+#include "ParallelSelect.h"
+
+#include <TaskTracer.h>
 
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <queue>
 #include <random>
 #include <sstream>
 
 #ifdef WIN32
 #include <windows.h>
+#include <psapi.h>
 size_t ArraySort::availableSystemMemory()
 {
   MEMORYSTATUSEX statex;
@@ -15,7 +22,20 @@ size_t ArraySort::availableSystemMemory()
   ::GlobalMemoryStatusEx(&statex);
   return statex.ullAvailPhys;
 }
+
+size_t ArraySort::pageFaultCount()
+{
+  PROCESS_MEMORY_COUNTERS counters{};
+  return ::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PageFaultCount : 0;
+}
 #else
+#include <sys/resource.h>
+size_t ArraySort::pageFaultCount()
+{
+  rusage usage{};
+  return ::getrusage(RUSAGE_SELF, &usage) ? 0 : static_cast<size_t>(usage.ru_minflt + usage.ru_majflt);
+}
+
 //#include <unistd.h>
 // static size_t availableSystemMemory()
 //{
@@ -39,6 +59,24 @@ size_t ArraySort::availableSystemMemory()
 }
 #endif
 
+size_t ArraySort::maxFileArraySize(const std::string& filePath)
+{
+  std::error_code error{};
+  auto path = std::filesystem::absolute(filePath, error);
+  auto fileSize = std::filesystem::file_size(path, error);
+  auto space = std::filesystem::space(path.parent_path(), error);
+  if (error)
+    return 0;
+  // The array file is rewritten, so its current size is free as well
+  return (space.available + (fileSize == static_cast<std::uintmax_t>(-1) ? 0 : fileSize)) / 2 / sizeof(ArrayValue);
+}
+
+size_t ArraySort::maxRunSize(ThreadCount threadCount)
+{
+  assert(threadCount > 0);
+  return std::max<size_t>(availableSystemMemory() / 2 / threadCount / sizeof(ArrayValue), 1);
+}
+
 size_t ArraySort::minArraySize(ThreadCount threadCount) noexcept
 {
   assert(threadCount > 0);
@@ -52,85 +90,285 @@ std::string ArraySort::threadIdToStr(ThreadId threadId)
   return ss.str();
 }
 
-ArraySort::ArraySort(SortStartEventFn&& taskStartEventFn, SortProgressEventFn&& taskProgressEventFn, SortEndEventFn&& taskEndEventFn)
-  : _taskLauncher{}
-  , _array(minArraySize(_taskLauncher.threadCount()))
+// Counter based generator (splitmix64), so values do not depend on the way the array is split between tasks
+static uint64_t randomValue(uint64_t seed, uint64_t index) noexcept
+{
+  auto value = seed + (index + 1) * 0x9E3779B97F4A7C15ull;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+  return value ^ (value >> 31);
+}
+
+ArraySort::ArraySort(SortStartEventFn&& taskStartEventFn, SortEndEventFn&& taskEndEventFn, ThreadCount threadCount, const std::string& arrayFilePath)
+  : _taskLauncher{ threadCount, &TaskBudget::global() }
+  , _array{}
+  , _arrayFilePath{ arrayFilePath }
   , _interruptFlag{ false }
+  , _operation{ SortOperation::SORT }
+  , _selectCount{ 0 }
+  , _partSize{ 1 }
+  , _partCount{ 0 }
+  , _tasks{}
+  , _firstTaskId{ 0 }
+  , _isMerged{ false }
+  , _mergeTaskId{ 0 }
+  , _sortedRunCount{ 0 }
+  , _taskCount{ 0 }
+  , _finishedTaskCount{ 0 }
   , _taskStartEventFn{ std::move(taskStartEventFn) }
-  , _taskProgressEventFn{ std::move(taskProgressEventFn) }
   , _taskEndEventFn{ std::move(taskEndEventFn) }
 {
-  assert(_taskStartEventFn && _taskProgressEventFn && _taskEndEventFn);
+  assert(_taskStartEventFn && _taskEndEventFn);
+  generateArray(minArraySize(_taskLauncher.threadCount()));
+}
+
+void ArraySort::setArrayFile(const std::string& filePath)
+{
+  if (filePath == _arrayFilePath)
+    return;
+  _arrayFilePath = filePath;
   generateArray(_array.size());
 }
 
-SortTaskIndex ArraySort::finishTask(TaskId taskId)
+size_t ArraySort::finishTask(SortTaskState& task) noexcept
 {
-  auto& taskIndex = _taskIndexes.at(taskId);
-  taskIndex.second = true;
-  return taskIndex.first;
+  task.isFinished.store(true, std::memory_order_release);
+  return _finishedTaskCount.fetch_add(1, std::memory_order_acq_rel) + 1;
 }
 
-bool ArraySort::areAllTasksFinished() const
+void ArraySort::finishRun(SortTaskState& task, bool isSorted)
 {
-  auto result = !taskCount() || (taskCount() == threadCount());
-  for (const auto& taskIndex : _taskIndexes)
-    if (!(result = result && taskIndex.second.second))
-      break;
-  return result;
+  if (isSorted)
+    _sortedRunCount.fetch_add(1, std::memory_order_release);
+  if ((finishTask(task) != _partCount) || !_isMerged)
+    return;
+  // The last run merges the runs only if all of them are sorted, the merge task is not queued after an interruption
+  if ((_sortedRunCount.load(std::memory_order_acquire) == _partCount) && !_interruptFlag)
+    _taskLauncher.queueTask(
+      _taskEndEventFn, [this](TaskId taskId) { return _operation == SortOperation::SORT ? mergeRuns(taskId) : mergeCandidates(taskId); });
+  else
+    finishTask(_tasks[_partCount]);
+}
+
+SortTaskHandles ArraySort::select(SortOperation operation, size_t count, size_t grain)
+{
+  return queueParts(operation, count, grain, std::nullopt);
+}
+
+SortTaskHandles ArraySort::generateAndSort(size_t arraySize, ArrayDistribution distribution, uint64_t seed, size_t grain)
+{
+  resetArray(arraySize);
+  return queueParts(SortOperation::SORT, 0, grain ? grain : coreCacheBudget / sizeof(ArrayValue),
+    ArrayFill{ distribution, seed ? seed : std::random_device{}() });
 }
 
-void ArraySort::sort()
+SortTaskHandles ArraySort::queueParts(SortOperation operation, size_t count, size_t grain, const std::optional<ArrayFill>& fill)
 {
-  clearTasks();
-  _taskLauncher.queueBatch(
-    0, _array.size(), 0,
-    [this](TaskId taskId, size_t from, size_t to) -> std::string
+  auto size = _array.size();
+  _operation = operation;
+  // The value of the index is the greatest of the selected ones
+  _selectCount = operation == SortOperation::SORT ? size : std::clamp<size_t>(operation == SortOperation::NTH_ELEMENT ? count + 1 : count, 1, size);
+  _partSize = grain ? std::min(grain, size) : size / threadCount() + (size % threadCount() ? 1 : 0);
+  if (_array.isMapped())
+    _partSize = std::min(_partSize, maxRunSize(threadCount()));
+  _partCount = size / _partSize + (size % _partSize ? 1 : 0);
+  _isMerged = (_partCount > 1) && (_array.isMapped() || (operation != SortOperation::SORT));
+  _taskCount = taskCount();
+  _tasks = std::make_unique<SortTaskState[]>(_taskCount);
+  _mergeTaskId = 0;
+  _sortedRunCount = 0;
+  _finishedTaskCount = 0;
+  auto taskHandles = _taskLauncher.queueBatch(
+    0, size, _partSize,
+    [this, fill](TaskId taskId, size_t from, size_t to) -> std::string
     {
-      auto threadOperIndex = size_t(0);
-      auto threadOperCount = operCount(to - from);
-      auto progressGrain = ArraySort::progressGrain(threadOperCount);
-      auto threadCmpPred = [this, taskId, &threadOperIndex, threadOperCount, progressGrain](const ArrayValue& l, const ArrayValue& r) mutable -> bool
+      auto& task = _tasks[partIndex(from)];
+      auto storeProgress = [&task](size_t, SortTaskProgress progress) { task.progress.store(progress, std::memory_order_relaxed); };
+      auto isInterrupted = [this]() { return _interruptFlag.load(std::memory_order_relaxed); };
+      _taskStartEventFn(taskId, std::this_thread::get_id(), from, to);
+      auto candidateCount = std::min(_selectCount, to - from);
+      try
       {
-        if (threadOperIndex && !(threadOperIndex % progressGrain))
+        if (fill)
         {
-          auto progress = static_cast<SortTaskProgress>(threadOperIndex) / threadOperCount;
-          _taskProgressEventFn(taskId, progress >= 0.99 ? 0.99 : progress);
-          if (_interruptFlag)
-            throw std::runtime_error("Task with id = " + std::to_string(taskId) + " was interrupted!");
+          TaskTraceSpan span{ "generate chunk", taskId };
+          fillArray(from, to, *fill);
         }
-        threadOperIndex++;
-        return l < r;
-      };
-      _taskStartEventFn(taskId, std::this_thread::get_id(), from, to);
-      std::sort(_array.begin() + from, _array.begin() + to, threadCmpPred);
-      return "min = " + std::to_string(_array[from]) + ", max = " + std::to_string(_array[to - 1]);
+        else
+          _array.advise(ArrayAccess::WILL_NEED, from, to);
+        TaskTraceSpan span{ "sort chunk", taskId };
+        if (_operation == SortOperation::TOP_K)
+          selectChunk(_array.begin() + from, _array.begin() + to, candidateCount, std::greater<>{}, 0, storeProgress, isInterrupted);
+        else
+          selectChunk(_array.begin() + from, _array.begin() + to, candidateCount, std::less<>{}, 0, storeProgress, isInterrupted);
+      }
+      catch (const SortInterrupted&)
+      {
+        finishRun(task, false);
+        throw std::runtime_error("Task with id = " + std::to_string(taskId) + " was interrupted!");
+      }
+      catch (...)
+      {
+        finishRun(task, false);
+        throw;
+      }
+      auto [min, max] = std::minmax(_array[from], _array[from + candidateCount - 1]);
+      auto result = "min = " + std::to_string(min) + ", max = " + std::to_string(max);
+      // The sorted run is written back, its pages may be dropped until the merge
+      _array.advise(ArrayAccess::DONT_NEED, from, to);
+      finishRun(task, true);
+      return result;
     },
     _taskEndEventFn);
+  _firstTaskId = taskHandles.front().id;
+  return taskHandles;
+}
+
+std::string ArraySort::mergeRuns(TaskId taskId)
+{
+  // Values are written by blocks of the size
+  static constexpr size_t mergeBufferSize = 1 << 16;
+
+  auto& task = _tasks[_partCount];
+  auto size = _array.size();
+  _mergeTaskId = taskId;
+  _taskStartEventFn(taskId, std::this_thread::get_id(), 0, size);
+  try
+  {
+    TaskTraceSpan span{ "merge runs", taskId };
+    _array.advise(ArrayAccess::SEQUENTIAL, 0, size);
+    // The current value of every run with its index, the least value is on the top
+    using RunCursor = std::pair<ArrayValue, size_t>;
+    std::priority_queue<RunCursor, std::vector<RunCursor>, std::greater<RunCursor>> cursors{};
+    for (size_t from = 0; from < size; from += _partSize)
+      cursors.push({ _array[from], from });
+
+    auto mergeFilePath = _array.filePath() + ".merge";
+    std::ofstream file{ mergeFilePath, std::ios::binary | std::ios::trunc };
+    std::vector<ArrayValue> buffer{};
+    buffer.reserve(mergeBufferSize);
+    size_t mergedCount{ 0 };
+    while (!cursors.empty() && file)
+    {
+      auto [value, index] = cursors.top();
+      cursors.pop();
+      buffer.push_back(value);
+      if ((++index % _partSize) && (index < size))
+        cursors.push({ _array[index], index });
+      if ((buffer.size() == mergeBufferSize) || cursors.empty())
+      {
+        file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(ArrayValue)));
+        mergedCount += buffer.size();
+        buffer.clear();
+        auto progress = static_cast<SortTaskProgress>(mergedCount) / size;
+        task.progress.store(progress >= 0.99 ? 0.99 : progress, std::memory_order_relaxed);
+        if (_interruptFlag)
+          break;
+      }
+    }
+    file.close();
+    if (!file || _interruptFlag)
+    {
+      std::error_code error{};
+      std::filesystem::remove(mergeFilePath, error);
+      throw std::runtime_error(_interruptFlag ? "Task with id = " + std::to_string(taskId) + " was interrupted!" : "Can't write " + mergeFilePath);
+    }
+    _array.replaceFile(mergeFilePath);
+  }
+  catch (...)
+  {
+    finishTask(task);
+    throw;
+  }
+  task.progress.store(1.0, std::memory_order_relaxed);
+  finishTask(task);
+  return "runs = " + std::to_string(_partCount) + ", min = " + std::to_string(_array[0]) + ", max = " + std::to_string(_array[size - 1]);
+}
+
+std::string ArraySort::mergeCandidates(TaskId taskId)
+{
+  auto& task = _tasks[_partCount];
+  auto size = _array.size();
+  _mergeTaskId = taskId;
+  _taskStartEventFn(taskId, std::this_thread::get_id(), 0, size);
+  try
+  {
+    TaskTraceSpan span{ "merge candidates", taskId };
+    auto merge = [this, &task, taskId, size](auto compare)
+    {
+      auto counts = selectCounts(_array.begin(), size, _partSize, _selectCount, compare);
+      task.progress.store(0.5, std::memory_order_relaxed);
+      if (_interruptFlag)
+        throw std::runtime_error("Task with id = " + std::to_string(taskId) + " was interrupted!");
+      arrangeSelection(_array.begin(), size, _partSize, _selectCount, counts, compare, _operation != SortOperation::NTH_ELEMENT);
+    };
+    if (_operation == SortOperation::TOP_K)
+      merge(std::greater<>{});
+    else
+      merge(std::less<>{});
+  }
+  catch (...)
+  {
+    finishTask(task);
+    throw;
+  }
+  task.progress.store(1.0, std::memory_order_relaxed);
+  finishTask(task);
+  if (_operation == SortOperation::NTH_ELEMENT)
+    return "nth = " + std::to_string(_selectCount - 1) + ", value = " + std::to_string(_array[_selectCount - 1]);
+  auto [min, max] = std::minmax(_array[0], _array[_selectCount - 1]);
+  return "count = " + std::to_string(_selectCount) + ", min = " + std::to_string(min) + ", max = " + std::to_string(max);
 }
 
 void ArraySort::interrupt()
 {
   _taskLauncher.stopAndWait(&_interruptFlag);
   _taskLauncher.clear();
+  // The dropped tasks will never finish
+  _taskCount = _finishedTaskCount;
   _interruptFlag = false;
   _taskLauncher.start();
 }
 
-void ArraySort::generateArray(size_t arraySize)
+void ArraySort::generateArray(size_t arraySize, ArrayDistribution distribution, uint64_t seed)
 {
-  interrupt();
-  decltype(_array){}.swap(_array);
-  _array.resize(arraySize);
+  resetArray(arraySize);
+  TaskTraceSpan span{ "generate" };
   auto taskHandles = _taskLauncher.queueBatch(0, _array.size(), 0,
-    [this](TaskId taskId, size_t from, size_t to)
+    [this, fill = ArrayFill{ distribution, seed ? seed : std::random_device{}() }](TaskId taskId, size_t from, size_t to)
     {
-      std::uniform_int_distribution<ArrayValue> distribution(0, (std::numeric_limits<ArrayValue>::max)());
-      std::mt19937 randomEngine{ std::random_device{}() };
-      auto random = std::bind(distribution, randomEngine);
-      for (auto index = from; index < to; ++index)
-        _array[index] = random();
+      TaskTraceSpan span{ "generate chunk", taskId };
+      fillArray(from, to, fill);
     });
   for (auto& taskHandle : taskHandles)
     taskHandle.result.wait();
 }
+
+void ArraySort::resetArray(size_t arraySize)
+{
+  interrupt();
+  // The previous buffer is returned to the pool (or the file is unmapped) before the new array is taken
+  Array{}.swap(_array);
+  _array = _arrayFilePath.empty() ? Array{ arraySize } : Array{ _arrayFilePath, arraySize };
+}
+
+void ArraySort::fillArray(size_t from, size_t to, const ArrayFill& fill)
+{
+  auto maxValue = static_cast<uint64_t>((std::numeric_limits<ArrayValue>::max)());
+  auto size = _array.size();
+  for (auto index = from; index < to; ++index)
+    switch (fill.distribution)
+    {
+    case ArrayDistribution::SORTED:
+      _array[index] = static_cast<ArrayValue>(index * maxValue / size);
+      break;
+    case ArrayDistribution::REVERSED:
+      _array[index] = static_cast<ArrayValue>((size - 1 - index) * maxValue / size);
+      break;
+    case ArrayDistribution::FEW_UNIQUE:
+      _array[index] = static_cast<ArrayValue>(randomValue(fill.seed, index) % 16);
+      break;
+    default:
+      _array[index] = static_cast<ArrayValue>(randomValue(fill.seed, index) % (maxValue + 1));
+    }
+}
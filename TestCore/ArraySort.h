@@ -1,14 +1,15 @@
 #ifndef ARRAY_SORT_H
 #define ARRAY_SORT_H
 
+#include "Array.h"
+
 #include <TaskLauncher.h>
 
-#include <cmath>
-#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <optional>
 #include <vector>
 
-using ArrayValue = int;
-using Array = std::vector<ArrayValue>;
 using ThreadId = std::thread::id;
 
 using IndexRange = std::pair<size_t, size_t>;
@@ -16,50 +17,127 @@ using SortTaskProgress = double;
 using SortTaskResult = TaskResult<std::string>;
 using SortTaskInfo = std::pair<ThreadId, IndexRange>;
 using SortTaskIndex = size_t;
-using SortTaskStatus = std::pair<SortTaskIndex, bool>;
 
 using SortStartEventFn = std::function<void(TaskId, ThreadId, size_t, size_t)>;
-using SortProgressEventFn = std::function<void(TaskId, SortTaskProgress)>;
 using SortEndEventFn = TaskEndEventFn<std::string>;
+using SortTaskHandles = std::vector<TaskHandle<std::string>>;
+
+// clang-format off
+struct _ArrayDistribution { enum ArrayDistribution : char { UNIFORM, SORTED, REVERSED, FEW_UNIQUE }; };
+// clang-format on
+using ArrayDistribution = _ArrayDistribution::ArrayDistribution;
+
+// clang-format off
+struct _SortOperation { enum SortOperation : char { SORT, PARTIAL_SORT, TOP_K, NTH_ELEMENT }; };
+// clang-format on
+using SortOperation = _SortOperation::SortOperation;
 
 class ArraySort
 {
 public:
   static size_t availableSystemMemory();
-  static size_t operCount(size_t arraySize) noexcept { return 2 * arraySize * std::log(arraySize); }
+  // Page faults of the process since its start
+  static size_t pageFaultCount();
   static size_t minArraySize(ThreadCount threadCount) noexcept;
   // 80% of available memory
   static size_t maxArraySize() noexcept { return 0.8 * availableSystemMemory() / sizeof(ArrayValue); }
+  // Half of the free space of the file directory: the merge of a file array writes a sorted copy
+  static size_t maxFileArraySize(const std::string& filePath);
+  // The run of a file array is sorted in memory, runs of all threads take no more than half of available memory
+  static size_t maxRunSize(ThreadCount threadCount);
   static std::string threadIdToStr(ThreadId threadId);
-  static size_t progressGrain(size_t operCount) noexcept { return operCount >= 20 ? operCount / 20 : 1; }
 
 public:
-  ArraySort(SortStartEventFn&& taskStartEventFn, SortProgressEventFn&& taskProgressEventFn, SortEndEventFn&& taskEndEventFn);
+  // Sorts of all instances draw from the global task budget, so they do not oversubscribe the CPUs.
+  // The initial array is generated in the given file or in memory if the path is empty.
+  ArraySort(SortStartEventFn&& taskStartEventFn, SortEndEventFn&& taskEndEventFn, ThreadCount threadCount = std::thread::hardware_concurrency(),
+    const std::string& arrayFilePath = {});
   ~ArraySort() { _taskLauncher.stopAndWait(&_interruptFlag); }
 
   auto threadCount() const noexcept { return _taskLauncher.threadCount(); }
   auto minArraySize() const noexcept { return minArraySize(threadCount()); }
   auto arraySize() const noexcept { return _array.size(); }
-  void sort();
-  void generateArray(size_t arraySize);
+  const Array& array() const noexcept { return _array; }
+  // Arrays are generated in the given file (external sort) or in memory if the path is empty.
+  // A new path regenerates the array of the current size in the new storage.
+  void setArrayFile(const std::string& filePath);
+  const std::string& arrayFile() const noexcept { return _arrayFilePath; }
+  auto maxStorageArraySize() const { return _arrayFilePath.empty() ? maxArraySize() : maxFileArraySize(_arrayFilePath); }
+  // Sorts parts of the array of the given size (0 is a part per thread). Parts of a file array are sorted runs,
+  // the last finished run queues the task merging them into the sorted file.
+  SortTaskHandles sort(size_t grain = 0) { return select(SortOperation::SORT, 0, grain); }
+  // Selects values by parts: every part puts its candidates, its count least (greatest for TOP_K) values, sorted at its front,
+  // the last finished part queues the task merging the candidates. PARTIAL_SORT and TOP_K put the count least or greatest values
+  // sorted at the front of the array, NTH_ELEMENT puts the value of the index count at its sorted place with no greater values
+  // before it and no less values after it.
+  SortTaskHandles select(SortOperation operation, size_t count, size_t grain = 0);
+  // The same seed gives the same array regardless of the thread count, 0 is a random seed
+  void generateArray(size_t arraySize, ArrayDistribution distribution = ArrayDistribution::UNIFORM, uint64_t seed = 0);
+  // Generates the array by the parts of the sort: the task of a part generates it and sorts it while it is in the cache of the core,
+  // instead of passing the whole array through the memory twice. The grain is the core cache budget if it is 0.
+  SortTaskHandles generateAndSort(size_t arraySize, ArrayDistribution distribution = ArrayDistribution::UNIFORM, uint64_t seed = 0, size_t grain = 0);
   void interrupt();
 
-  auto saveTask(TaskId taskId) { return _taskIndexes.insert({ taskId, { _taskIndexes.size(), false } }).first->second.first; }
-  auto clearTasks() noexcept { _taskIndexes.clear(); }
-  SortTaskIndex finishTask(TaskId taskId);
-  auto taskCount() const noexcept { return _taskIndexes.size(); }
-  auto isTaskSaved(TaskId taskId) const { return _taskIndexes.find(taskId) != _taskIndexes.cend(); }
-  auto taskIndex(TaskId taskId) const { return _taskIndexes.at(taskId).first; }
-  auto isTaskFinished(TaskId taskId) const { return _taskIndexes.at(taskId).second; }
-  bool areAllTasksFinished() const;
+  // The array is sorted by parts, the task of a part overwrites its progress slot, which is sampled by the UI
+  auto partCount() const noexcept { return _partCount; }
+  SortTaskIndex partIndex(size_t from) const noexcept { return from / _partSize; }
+
+  // Tasks of the last sort: a task per part have contiguous ids, the merge task of a file array or of a selection is the last one
+  auto taskCount() const noexcept { return _partCount + (_isMerged ? 1 : 0); }
+  bool isBatchTask(TaskId taskId) const noexcept
+  {
+    return ((taskId >= _firstTaskId) && (taskId - _firstTaskId < static_cast<TaskId>(_partCount))) || (_isMerged && (taskId == _mergeTaskId));
+  }
+  SortTaskIndex taskIndex(TaskId taskId) const noexcept { return _isMerged && (taskId == _mergeTaskId) ? _partCount : static_cast<SortTaskIndex>(taskId - _firstTaskId); }
+  SortTaskProgress taskProgress(SortTaskIndex taskIndex) const noexcept { return _tasks[taskIndex].progress.load(std::memory_order_relaxed); }
+  bool isTaskFinished(TaskId taskId) const noexcept { return _tasks[taskIndex(taskId)].isFinished.load(std::memory_order_acquire); }
+  bool areAllTasksFinished() const noexcept { return _finishedTaskCount.load(std::memory_order_acquire) == _taskCount; }
+
+private:
+  struct ArrayFill
+  {
+    ArrayDistribution distribution;
+    uint64_t seed;
+  };
+
+  // Padded to a cache line, so workers of neighbouring tasks do not share it
+  struct alignas(64) SortTaskState
+  {
+    std::atomic<SortTaskProgress> progress;
+    std::atomic<bool> isFinished;
+  };
+
+  // Interrupts the tasks and allocates the array of the size
+  void resetArray(size_t arraySize);
+  void fillArray(size_t from, size_t to, const ArrayFill& fill);
+  // Parts are generated before their selection if the fill is given
+  SortTaskHandles queueParts(SortOperation operation, size_t count, size_t grain, const std::optional<ArrayFill>& fill);
+  // Returns the number of finished tasks
+  size_t finishTask(SortTaskState& task) noexcept;
+  void finishRun(SortTaskState& task, bool isSorted);
+  std::string mergeRuns(TaskId taskId);
+  std::string mergeCandidates(TaskId taskId);
 
 private:
   TaskLauncher _taskLauncher;
   Array _array;
+  std::string _arrayFilePath;
   std::atomic<bool> _interruptFlag;
-  std::unordered_map<TaskId, std::pair<size_t, bool>> _taskIndexes;
+  SortOperation _operation;
+  // Values selected at the front of the array, all of them for SORT
+  size_t _selectCount;
+  size_t _partSize;
+  size_t _partCount;
+  std::unique_ptr<SortTaskState[]> _tasks;
+  TaskId _firstTaskId;
+  bool _isMerged;
+  // Known when the merge task starts
+  std::atomic<TaskId> _mergeTaskId;
+  std::atomic<size_t> _sortedRunCount;
+  // Tasks of the last sort expected to finish, the queued ones are dropped by the interruption
+  size_t _taskCount;
+  std::atomic<size_t> _finishedTaskCount;
   SortStartEventFn _taskStartEventFn;
-  SortProgressEventFn _taskProgressEventFn;
   SortEndEventFn _taskEndEventFn;
 };
 
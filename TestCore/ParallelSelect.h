@@ -0,0 +1,191 @@
+#ifndef PARALLEL_SELECT_H
+#define PARALLEL_SELECT_H
+
+#include "ParallelSort.h"
+
+#include <queue>
+
+// Selection of the count least values of a range split into chunks of the grain size: every chunk puts its candidates,
+// the count least values of the chunk, sorted at its front in parallel, then the final merge of the candidates moves
+// the selected values to the front of the range. Equal values are taken from the preceding chunks first.
+
+// Puts the count least values of the chunk sorted at its front, the whole chunk is sorted if it is not larger
+template <typename TIterator, typename TCompare, typename TProgress = NoSortProgress, typename TInterrupt = NoSortInterrupt>
+void selectChunk(TIterator first, TIterator last, size_t count, TCompare compare, size_t chunkIndex = 0, const TProgress& progress = {},
+  const TInterrupt& interrupt = {})
+{
+  auto size = static_cast<size_t>(std::distance(first, last));
+  if (count >= size)
+    sortChunk(first, last, compare, chunkIndex, progress, interrupt);
+  else
+    runChunk(size + sortOperCount(count), compare, chunkIndex, progress, interrupt,
+      [first, last, middle = first + count](auto chunkCompare) { std::partial_sort(first, middle, last, chunkCompare); });
+}
+
+// Numbers of the candidates of every chunk taken by the count least values of the range, the candidates are at the chunk fronts.
+// The candidate of a chunk is taken if fewer than count values precede it: candidates of the preceding chunks not greater than it
+// and candidates of the following chunks less than it. Candidates of other chunks are counted by binary searches.
+template <typename TIterator, typename TCompare>
+std::vector<size_t> selectCounts(TIterator first, size_t size, size_t grain, size_t count, TCompare& compare)
+{
+  auto chunkCount = size / grain + (size % grain ? 1 : 0);
+  auto candidates = [first, size, grain, count](size_t chunkIndex)
+  {
+    auto chunkFirst = first + chunkIndex * grain;
+    return std::make_pair(chunkFirst, chunkFirst + std::min({ count, grain, size - chunkIndex * grain }));
+  };
+  std::vector<size_t> counts(chunkCount);
+  for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+  {
+    auto [chunkFirst, chunkLast] = candidates(chunkIndex);
+    auto isTaken = [&candidates, &compare, chunkIndex, chunkCount, count](size_t rank, const auto& value)
+    {
+      for (size_t otherIndex = 0; (otherIndex < chunkCount) && (rank < count); ++otherIndex)
+      {
+        auto [otherFirst, otherLast] = candidates(otherIndex);
+        if (otherIndex < chunkIndex)
+          rank += static_cast<size_t>(std::upper_bound(otherFirst, otherLast, value, compare) - otherFirst);
+        else if (otherIndex > chunkIndex)
+          rank += static_cast<size_t>(std::lower_bound(otherFirst, otherLast, value, compare) - otherFirst);
+      }
+      return rank < count;
+    };
+    // Ranks of the candidates grow along the chunk
+    size_t low{ 0 };
+    auto high = static_cast<size_t>(std::distance(chunkFirst, chunkLast));
+    while (low < high)
+    {
+      auto middle = (low + high) / 2;
+      if (isTaken(middle, chunkFirst[middle]))
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    counts[chunkIndex] = low;
+  }
+  return counts;
+}
+
+// Moves the selected candidates to [first, first + count): merged into the sorted order if isSorted, otherwise in any order
+// with the greatest of them last. Values of the range not selected take the places left by the selected ones.
+template <typename TIterator, typename TCompare>
+void arrangeSelection(TIterator first, size_t size, size_t grain, size_t count, const std::vector<size_t>& counts, TCompare& compare, bool isSorted)
+{
+  using Value = typename std::iterator_traits<TIterator>::value_type;
+  auto chunkCount = counts.size();
+  // Every selected value outside the front takes the place of a value at the front, which is not selected
+  auto forEachPlace = [first, size, grain, count, &counts, chunkCount](auto placeFn)
+  {
+    size_t holeChunk{ 0 };
+    auto hole = counts[0];
+    for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+    {
+      auto chunkFrom = chunkIndex * grain;
+      for (auto index = std::max(chunkFrom, count); index < chunkFrom + counts[chunkIndex]; ++index)
+      {
+        while (hole >= std::min((holeChunk + 1) * grain, size))
+        {
+          ++holeChunk;
+          hole = holeChunk * grain + counts[holeChunk];
+        }
+        placeFn(first + index, first + hole++);
+      }
+    }
+  };
+  if (isSorted)
+  {
+    // Chunks with the least current candidate are on the top, equal candidates are taken from the preceding chunk
+    std::vector<size_t> cursors(chunkCount);
+    auto isAfter = [first, grain, &cursors, &compare](size_t l, size_t r)
+    {
+      auto& lValue = first[l * grain + cursors[l]];
+      auto& rValue = first[r * grain + cursors[r]];
+      return compare(rValue, lValue) || (!compare(lValue, rValue) && (l > r));
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(isAfter)> chunks{ isAfter };
+    for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+      if (counts[chunkIndex])
+        chunks.push(chunkIndex);
+    std::vector<Value> selection{};
+    selection.reserve(count);
+    while (!chunks.empty())
+    {
+      auto chunkIndex = chunks.top();
+      chunks.pop();
+      selection.push_back(std::move(first[chunkIndex * grain + cursors[chunkIndex]]));
+      if (++cursors[chunkIndex] < counts[chunkIndex])
+        chunks.push(chunkIndex);
+    }
+    forEachPlace([](TIterator selected, TIterator hole) { *selected = std::move(*hole); });
+    std::move(selection.begin(), selection.end(), first);
+  }
+  else
+  {
+    // The greatest selected value is the last candidate taken from some chunk, the last of the equal ones
+    auto greatest = first + size;
+    for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+      if (counts[chunkIndex])
+      {
+        auto candidate = first + (chunkIndex * grain + counts[chunkIndex] - 1);
+        if ((greatest == first + size) || !compare(*candidate, *greatest))
+          greatest = candidate;
+      }
+    forEachPlace(
+      [&greatest](TIterator selected, TIterator hole)
+      {
+        std::iter_swap(selected, hole);
+        if (selected == greatest)
+          greatest = hole;
+      });
+    std::iter_swap(greatest, first + (count - 1));
+  }
+}
+
+template <typename TIterator, typename TCompare, typename TProgress, typename TInterrupt>
+void parallelSelect(TaskLauncher& launcher, TIterator first, TIterator last, size_t count, TCompare& compare, size_t grain, bool isSorted,
+  const TProgress& progress, const TInterrupt& interrupt)
+{
+  auto size = static_cast<size_t>(std::distance(first, last));
+  if (!count || (size < 2))
+    return;
+  grain = sortGrain(launcher, size, grain);
+  waitBatch(launcher,
+    launcher.queueBatch(0, size, grain,
+      [first, count, &compare, &progress, &interrupt, grain](TaskId, size_t from, size_t to)
+      { selectChunk(first + from, first + to, count, compare, from / grain, progress, interrupt); }));
+  if (grain >= size)
+    return;
+  if (interrupt())
+    throw SortInterrupted{};
+  auto counts = selectCounts(first, size, grain, count, compare);
+  arrangeSelection(first, size, grain, count, counts, compare, isSorted);
+}
+
+// Parallel std::partial_sort: [first, middle) takes the least values of the range sorted, the rest of the values are in any order
+template <typename TIterator, typename TCompare = std::less<>, typename TProgress = NoSortProgress, typename TInterrupt = NoSortInterrupt>
+void parallelPartialSort(TaskLauncher& launcher, TIterator first, TIterator middle, TIterator last, TCompare compare = {}, size_t grain = 0,
+  const TProgress& progress = {}, const TInterrupt& interrupt = {})
+{
+  parallelSelect(launcher, first, last, static_cast<size_t>(std::distance(first, middle)), compare, grain, true, progress, interrupt);
+}
+
+// Parallel std::nth_element: nth takes the value it would have in the sorted range, no value before it is greater
+// and no value after it is less
+template <typename TIterator, typename TCompare = std::less<>, typename TProgress = NoSortProgress, typename TInterrupt = NoSortInterrupt>
+void parallelNthElement(TaskLauncher& launcher, TIterator first, TIterator nth, TIterator last, TCompare compare = {}, size_t grain = 0,
+  const TProgress& progress = {}, const TInterrupt& interrupt = {})
+{
+  if (nth != last)
+    parallelSelect(launcher, first, last, static_cast<size_t>(std::distance(first, nth)) + 1, compare, grain, false, progress, interrupt);
+}
+
+// The count greatest values of the range sorted in descending order at its front
+template <typename TIterator, typename TCompare = std::less<>, typename TProgress = NoSortProgress, typename TInterrupt = NoSortInterrupt>
+void parallelTopK(TaskLauncher& launcher, TIterator first, TIterator last, size_t count, TCompare compare = {}, size_t grain = 0,
+  const TProgress& progress = {}, const TInterrupt& interrupt = {})
+{
+  auto reversedCompare = [&compare](const auto& l, const auto& r) { return compare(r, l); };
+  parallelSelect(launcher, first, last, std::min(count, static_cast<size_t>(std::distance(first, last))), reversedCompare, grain, true, progress, interrupt);
+}
+
+#endif // PARALLEL_SELECT_H
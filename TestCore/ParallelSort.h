@@ -0,0 +1,414 @@
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+#include <TaskAlgorithms.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Thrown by sorting stopped by its interrupt policy
+class SortInterrupted : public std::runtime_error
+{
+public:
+  SortInterrupted()
+    : std::runtime_error{ "Sorting was interrupted!" }
+  {
+  }
+};
+
+// Default policies, sorting without progress and interrupt policies is not instrumented at all.
+// A progress policy is called as progress(chunkIndex, progressOfChunk), an interrupt policy returns true to stop sorting.
+// Policies are called concurrently by the tasks sorting different chunks.
+struct NoSortProgress
+{
+  void operator()(size_t, double) const noexcept {}
+};
+
+struct NoSortInterrupt
+{
+  bool operator()() const noexcept { return false; }
+};
+
+template <typename TProgress, typename TInterrupt>
+inline constexpr bool isSortInstrumented = !std::is_same_v<TProgress, NoSortProgress> || !std::is_same_v<TInterrupt, NoSortInterrupt>;
+
+// Radix key of the type: an unsigned integer ordered as the values are ordered by std::less.
+// Specialize it to sort other types (for example small structs by a key field) by the radix sort.
+template <typename T, typename = void>
+struct SortRadixKey
+{
+  static constexpr bool isEnabled = false;
+};
+
+template <typename T>
+struct SortRadixKey<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+{
+  static constexpr bool isEnabled = true;
+  using Key = std::make_unsigned_t<T>;
+
+  static Key key(T value) noexcept
+  {
+    // Negative values precede positive ones with the sign bit flipped
+    if constexpr (std::is_signed_v<T>)
+      return static_cast<Key>(value) ^ (Key{ 1 } << (std::numeric_limits<Key>::digits - 1));
+    else
+      return value;
+  }
+};
+
+template <typename T>
+struct SortRadixKey<T, std::enable_if_t<std::is_floating_point_v<T> && ((sizeof(T) == 4) || (sizeof(T) == 8))>>
+{
+  static constexpr bool isEnabled = true;
+  using Key = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+
+  static Key key(T value) noexcept
+  {
+    static constexpr auto signBit = Key{ 1 } << (std::numeric_limits<Key>::digits - 1);
+    Key bits{};
+    std::memcpy(&bits, &value, sizeof(bits));
+    // Negative values are ordered backwards by their bits
+    return bits & signBit ? ~bits : bits | signBit;
+  }
+};
+
+// The radix sort is used for radix keys compared by std::less only
+template <typename T, typename TCompare>
+inline constexpr bool isRadixSortable = SortRadixKey<T>::isEnabled && (std::is_same_v<TCompare, std::less<T>> || std::is_same_v<TCompare, std::less<>>);
+
+// Comparisons of sorting the given number of values
+inline size_t sortOperCount(size_t size) noexcept
+{
+  return size > 1 ? static_cast<size_t>(2 * size * std::log(size)) : 0;
+}
+
+// Policies are called 20 times per chunk
+inline size_t sortProgressGrain(size_t operCount) noexcept
+{
+  return operCount >= 20 ? operCount / 20 : 1;
+}
+
+// Chunk size of the grain, 0 is a chunk per thread
+inline size_t sortGrain(const TaskLauncher& launcher, size_t size, size_t grain) noexcept
+{
+  return std::max<size_t>(grain ? std::min(grain, size) : size / launcher.threadCount() + (size % launcher.threadCount() ? 1 : 0), 1);
+}
+
+// Runs the algorithm of the chunk with the comparator, which calls the policies every progress grain of the expected comparisons
+template <typename TCompare, typename TProgress, typename TInterrupt, typename TAlgorithm>
+void runChunk(size_t operCount, TCompare& compare, size_t chunkIndex, const TProgress& progress, const TInterrupt& interrupt, TAlgorithm&& algorithm)
+{
+  if constexpr (!isSortInstrumented<TProgress, TInterrupt>)
+    algorithm(compare);
+  else
+  {
+    auto progressGrain = sortProgressGrain(operCount);
+    size_t operIndex{ 0 };
+    algorithm(
+      [&compare, &progress, &interrupt, &operIndex, chunkIndex, operCount, progressGrain](const auto& l, const auto& r)
+      {
+        if (operIndex && !(operIndex % progressGrain))
+        {
+          auto chunkProgress = static_cast<double>(operIndex) / operCount;
+          progress(chunkIndex, chunkProgress >= 0.99 ? 0.99 : chunkProgress);
+          if (interrupt())
+            throw SortInterrupted{};
+        }
+        operIndex++;
+        return compare(l, r);
+      });
+    progress(chunkIndex, 1.0);
+  }
+}
+
+// Sorts the chunk by comparisons on the calling thread
+template <typename TIterator, typename TCompare, typename TProgress = NoSortProgress, typename TInterrupt = NoSortInterrupt>
+void sortChunk(TIterator first, TIterator last, TCompare compare, size_t chunkIndex = 0, const TProgress& progress = {}, const TInterrupt& interrupt = {})
+{
+  runChunk(sortOperCount(static_cast<size_t>(std::distance(first, last))), compare, chunkIndex, progress, interrupt,
+    [first, last](auto chunkCompare) { std::sort(first, last, chunkCompare); });
+}
+
+// Number of values of the left run [0, leftSize) among the first count values of its stable merge with the right run
+template <typename TIterator, typename TCompare>
+size_t sortMergeRank(TIterator left, size_t leftSize, TIterator right, size_t rightSize, size_t count, TCompare& compare)
+{
+  auto low = count > rightSize ? count - rightSize : 0;
+  auto high = std::min(count, leftSize);
+  while (low < high)
+  {
+    auto leftCount = (low + high) / 2;
+    auto rightCount = count - leftCount;
+    // Equal values of the left run go first
+    if (rightCount && !compare(right[rightCount - 1], left[leftCount]))
+      low = leftCount + 1;
+    else
+      high = leftCount;
+  }
+  return low;
+}
+
+// Chunks are sorted in parallel, then sorted runs are merged by pairs. Every merge is split into pieces of the grain size
+// merged in parallel, runs are moved between the range and a buffer of the same size (values are default constructible).
+// The interrupt policy is checked before every chunk sort and every merge pass, which are finished once started, so an
+// interrupted sort leaves all values in the range.
+template <typename TIterator, typename TCompare = std::less<>, typename TProgress = NoSortProgress, typename TInterrupt = NoSortInterrupt>
+void parallelMergeSort(TaskLauncher& launcher, TIterator first, TIterator last, TCompare compare = {}, size_t grain = 0, const TProgress& progress = {},
+  const TInterrupt& interrupt = {})
+{
+  using Value = typename std::iterator_traits<TIterator>::value_type;
+  auto size = static_cast<size_t>(std::distance(first, last));
+  if (size < 2)
+    return;
+  grain = sortGrain(launcher, size, grain);
+  waitBatch(launcher,
+    launcher.queueBatch(0, size, grain,
+      [first, &compare, &progress, &interrupt, grain](TaskId, size_t from, size_t to)
+      {
+        if (interrupt())
+          throw SortInterrupted{};
+        sortChunk(first + from, first + to, compare, from / grain, progress, NoSortInterrupt{});
+      }));
+  if (grain >= size)
+    return;
+
+  std::vector<Value> buffer(size);
+  auto isInBuffer = false;
+  auto moveBack = [&launcher, first, &buffer, size, grain]()
+  {
+    waitBatch(launcher,
+      launcher.queueBatch(0, size, grain,
+        [first, &buffer](TaskId, size_t from, size_t to) { std::move(buffer.begin() + from, buffer.begin() + to, first + from); }));
+  };
+  auto merge = [&launcher, &compare, size, grain](auto source, auto target, size_t width)
+  {
+    // The pieces move the values of their pairs out of the source, so the ranks of all pieces are found before merging them
+    auto pieceCount = size / grain + (size % grain ? 1 : 0);
+    std::vector<size_t> leftRanks(pieceCount);
+    for (size_t pieceIndex = 0; pieceIndex < pieceCount; ++pieceIndex)
+    {
+      auto from = pieceIndex * grain;
+      auto pairFirst = from / (2 * width) * (2 * width);
+      auto pairMiddle = std::min(pairFirst + width, size);
+      auto pairLast = std::min(pairFirst + 2 * width, size);
+      leftRanks[pieceIndex] = sortMergeRank(source + pairFirst, pairMiddle - pairFirst, source + pairMiddle, pairLast - pairMiddle, from - pairFirst, compare);
+    }
+    // Pieces do not cross merged pairs, their size is a multiple of the grain
+    waitBatch(launcher,
+      launcher.queueBatch(0, size, grain,
+        [source, target, &compare, &leftRanks, size, grain, width](TaskId, size_t from, size_t to)
+        {
+          auto pairFirst = from / (2 * width) * (2 * width);
+          auto pairMiddle = std::min(pairFirst + width, size);
+          auto pairLast = std::min(pairFirst + 2 * width, size);
+          auto left = source + pairFirst;
+          auto right = source + pairMiddle;
+          auto leftSize = pairMiddle - pairFirst;
+          auto pieceIndex = from / grain;
+          auto leftFrom = leftRanks[pieceIndex];
+          auto leftTo = to < pairLast ? leftRanks[pieceIndex + 1] : leftSize;
+          auto rightFrom = from - pairFirst - leftFrom;
+          auto rightTo = to - pairFirst - leftTo;
+          std::merge(std::make_move_iterator(left + leftFrom), std::make_move_iterator(left + leftTo), std::make_move_iterator(right + rightFrom),
+            std::make_move_iterator(right + rightTo), target + from, compare);
+        }));
+  };
+  for (auto width = grain; width < size; width *= 2, isInBuffer = !isInBuffer)
+  {
+    if (interrupt())
+    {
+      if (isInBuffer)
+        moveBack();
+      throw SortInterrupted{};
+    }
+    if (isInBuffer)
+      merge(buffer.begin(), first, width);
+    else
+      merge(first, buffer.begin(), width);
+  }
+  if (isInBuffer)
+    moveBack();
+}
+
+// Parallel LSD radix sort by bytes of the radix key. Every pass counts the bytes of the chunks in parallel and moves the values
+// of the chunks to their places in parallel, passes with the same byte of all keys are skipped. The interrupt policy is checked
+// before every pass, which is finished once started, so an interrupted sort leaves all values in the range.
+template <typename TIterator, typename TProgress = NoSortProgress, typename TInterrupt = NoSortInterrupt>
+void parallelRadixSort(TaskLauncher& launcher, TIterator first, TIterator last, size_t grain = 0, const TProgress& progress = {}, const TInterrupt& interrupt = {})
+{
+  using Value = typename std::iterator_traits<TIterator>::value_type;
+  using RadixKey = SortRadixKey<Value>;
+  static_assert(RadixKey::isEnabled, "SortRadixKey is not specialized for the value type");
+  static constexpr size_t digitCount = 256;
+  static constexpr size_t passCount = sizeof(typename RadixKey::Key);
+
+  auto size = static_cast<size_t>(std::distance(first, last));
+  if (size < 2)
+    return;
+  grain = sortGrain(launcher, size, grain);
+  auto chunkCount = size / grain + (size % grain ? 1 : 0);
+  std::vector<Value> buffer(size);
+  // Digit counts of every chunk, then the places of the first values with the digits
+  std::vector<std::array<size_t, digitCount>> offsets(chunkCount);
+  auto isInBuffer = false;
+  auto moveBack = [&launcher, first, &buffer, size, grain]()
+  {
+    waitBatch(launcher,
+      launcher.queueBatch(0, size, grain,
+        [first, &buffer](TaskId, size_t from, size_t to) { std::move(buffer.begin() + from, buffer.begin() + to, first + from); }));
+  };
+  for (size_t pass = 0; pass < passCount; ++pass)
+  {
+    if (interrupt())
+    {
+      if (isInBuffer)
+        moveBack();
+      throw SortInterrupted{};
+    }
+    auto shift = pass * 8;
+    auto digit = [shift](const Value& value) { return static_cast<size_t>((RadixKey::key(value) >> shift) & (digitCount - 1)); };
+    auto count = [&launcher, &offsets, &digit, size, grain](auto source)
+    {
+      waitBatch(launcher,
+        launcher.queueBatch(0, size, grain,
+          [source, &offsets, &digit, grain](TaskId, size_t from, size_t to)
+          {
+            auto& counts = offsets[from / grain];
+            counts.fill(0);
+            for (auto index = from; index < to; ++index)
+              ++counts[digit(source[index])];
+          }));
+    };
+    if (isInBuffer)
+      count(buffer.begin());
+    else
+      count(first);
+
+    // Values are placed by digits, then by chunks, so the order of equal digits is kept
+    size_t offset{ 0 };
+    auto isSkipped = false;
+    for (size_t digitIndex = 0; digitIndex < digitCount; ++digitIndex)
+    {
+      auto digitFirst = offset;
+      for (auto& counts : offsets)
+      {
+        auto digitCountOfChunk = counts[digitIndex];
+        counts[digitIndex] = offset;
+        offset += digitCountOfChunk;
+      }
+      isSkipped = isSkipped || (offset - digitFirst == size);
+    }
+    if (isSkipped)
+      continue;
+
+    auto scatter = [&launcher, &offsets, &digit, &progress, size, grain, pass](auto source, auto target)
+    {
+      waitBatch(launcher,
+        launcher.queueBatch(0, size, grain,
+          [source, target, &offsets, &digit, &progress, grain, pass](TaskId, size_t from, size_t to)
+          {
+            auto chunkIndex = from / grain;
+            auto& places = offsets[chunkIndex];
+            for (auto index = from; index < to; ++index)
+              target[places[digit(source[index])]++] = std::move(source[index]);
+            progress(chunkIndex, static_cast<double>(pass + 1) / passCount);
+          }));
+    };
+    if (isInBuffer)
+      scatter(buffer.begin(), first);
+    else
+      scatter(first, buffer.begin());
+    isInBuffer = !isInBuffer;
+  }
+  if (isInBuffer)
+    moveBack();
+  if constexpr (!std::is_same_v<TProgress, NoSortProgress>)
+    for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+      progress(chunkIndex, 1.0);
+}
+
+// Sorts [first, last) on the launcher, the radix sort is chosen at compile time for radix keys compared by std::less
+template <typename TIterator, typename TCompare = std::less<>, typename TProgress = NoSortProgress, typename TInterrupt = NoSortInterrupt>
+void parallelSort(TaskLauncher& launcher, TIterator first, TIterator last, TCompare compare = {}, size_t grain = 0, const TProgress& progress = {},
+  const TInterrupt& interrupt = {})
+{
+  if constexpr (isRadixSortable<typename std::iterator_traits<TIterator>::value_type, TCompare>)
+    parallelRadixSort(launcher, first, last, grain, progress, interrupt);
+  else
+    parallelMergeSort(launcher, first, last, compare, grain, progress, interrupt);
+}
+
+// Key with the index of its payload, sorted instead of the key and the payload
+template <typename TKey>
+struct SortKeyIndex
+{
+  TKey key;
+  size_t index;
+};
+
+template <typename TKey>
+struct SortRadixKey<SortKeyIndex<TKey>, std::enable_if_t<SortRadixKey<TKey>::isEnabled>>
+{
+  static constexpr bool isEnabled = true;
+  using Key = typename SortRadixKey<TKey>::Key;
+
+  static Key key(const SortKeyIndex<TKey>& value) noexcept { return SortRadixKey<TKey>::key(value.key); }
+};
+
+// Sorts the keys [keysFirst, keysLast) with the payloads starting at payloadsFirst kept in a separate array (structure of arrays).
+// The keys are sorted with the indices of their payloads, payloads are never compared or moved while sorting and are permuted
+// by one parallel gather pass at the end. Equal keys keep their order. If the sort is interrupted, keys and payloads are unchanged.
+template <typename TKeyIterator, typename TPayloadIterator, typename TCompare = std::less<>, typename TProgress = NoSortProgress,
+  typename TInterrupt = NoSortInterrupt>
+void parallelSortByKey(TaskLauncher& launcher, TKeyIterator keysFirst, TKeyIterator keysLast, TPayloadIterator payloadsFirst, TCompare compare = {},
+  size_t grain = 0, const TProgress& progress = {}, const TInterrupt& interrupt = {})
+{
+  using Key = typename std::iterator_traits<TKeyIterator>::value_type;
+  using Payload = typename std::iterator_traits<TPayloadIterator>::value_type;
+  auto size = static_cast<size_t>(std::distance(keysFirst, keysLast));
+  if (size < 2)
+    return;
+  auto batchGrain = sortGrain(launcher, size, grain);
+  std::vector<SortKeyIndex<Key>> keyIndices(size);
+  waitBatch(launcher,
+    launcher.queueBatch(0, size, batchGrain,
+      [keysFirst, &keyIndices](TaskId, size_t from, size_t to)
+      {
+        for (auto index = from; index < to; ++index)
+          keyIndices[index] = { keysFirst[index], index };
+      }));
+  // The radix sort is stable, the chunk sorts of the merge sort are not: equal keys are ordered by their indices
+  if constexpr (isRadixSortable<Key, TCompare>)
+    parallelRadixSort(launcher, keyIndices.begin(), keyIndices.end(), grain, progress, interrupt);
+  else
+    parallelMergeSort(launcher, keyIndices.begin(), keyIndices.end(),
+      [&compare](const SortKeyIndex<Key>& l, const SortKeyIndex<Key>& r)
+      { return compare(l.key, r.key) || (!compare(r.key, l.key) && (l.index < r.index)); },
+      grain, progress, interrupt);
+
+  std::vector<Payload> payloads(size);
+  waitBatch(launcher,
+    launcher.queueBatch(0, size, batchGrain,
+      [keysFirst, payloadsFirst, &keyIndices, &payloads](TaskId, size_t from, size_t to)
+      {
+        for (auto index = from; index < to; ++index)
+        {
+          keysFirst[index] = std::move(keyIndices[index].key);
+          payloads[index] = std::move(payloadsFirst[keyIndices[index].index]);
+        }
+      }));
+  waitBatch(launcher,
+    launcher.queueBatch(0, size, batchGrain,
+      [payloadsFirst, &payloads](TaskId, size_t from, size_t to) { std::move(payloads.begin() + from, payloads.begin() + to, payloadsFirst + from); }));
+}
+
+#endif // PARALLEL_SORT_H
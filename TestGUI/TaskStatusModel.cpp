@@ -0,0 +1,131 @@
+#include "TaskStatusModel.h"
+
+#include <algorithm>
+#include <utility>
+
+TaskStatusModel::TaskStatusModel(QObject* parent)
+  : QAbstractTableModel(parent)
+  , _tasks{}
+  , _firstChangedRow{ -1 }
+  , _lastChangedRow{ -1 }
+  , _columnWidths{}
+  , _isColumnWidened{}
+{
+}
+
+int TaskStatusModel::rowCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : static_cast<int>(_tasks.size());
+}
+
+int TaskStatusModel::columnCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : Column::_COUNT;
+}
+
+QVariant TaskStatusModel::data(const QModelIndex& index, int role) const
+{
+  if ((role != Qt::DisplayRole) || !index.isValid() || (index.row() >= rowCount()))
+    return QVariant{};
+
+  // Rows of the parts which are not started yet are empty
+  const auto& task = _tasks[index.row()];
+  if (!task.taskId)
+    return QVariant{};
+  switch (index.column())
+  {
+  case Column::ID:
+    return task.taskId;
+  case Column::THREAD_ID:
+    return task.threadId;
+  case Column::INFO:
+    return task.range;
+  case Column::PROGRESS:
+    return task.progress;
+  case Column::RESULT:
+    return task.result;
+  default:
+    return QVariant{};
+  }
+}
+
+QVariant TaskStatusModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if ((role != Qt::DisplayRole) || (orientation != Qt::Horizontal))
+    return QAbstractTableModel::headerData(section, orientation, role);
+
+  static const char* headers[] = { "Id", "Thread Id", "Array Index Range", "Progress", "Result" };
+  return (0 <= section) && (section < Column::_COUNT) ? headers[section] : QVariant{};
+}
+
+void TaskStatusModel::reset(int rowCount)
+{
+  beginResetModel();
+  _tasks.assign(rowCount, TaskStatus{});
+  _firstChangedRow = _lastChangedRow = -1;
+  endResetModel();
+}
+
+void TaskStatusModel::startTask(int row, TaskId taskId, const QString& threadId, const QString& range)
+{
+  if ((0 <= row) && (row < rowCount()))
+  {
+    _tasks[row] = { taskId, threadId, range, 0, QString{} };
+    widenColumn(Column::ID, QString::number(taskId));
+    widenColumn(Column::THREAD_ID, threadId);
+    widenColumn(Column::INFO, range);
+    changeRow(row);
+  }
+}
+
+void TaskStatusModel::setProgress(int row, double progress)
+{
+  if ((0 <= row) && (row < rowCount()) && (_tasks[row].progress != progress))
+  {
+    _tasks[row].progress = progress;
+    widenColumn(Column::PROGRESS, QString::number(progress));
+    changeRow(row);
+  }
+}
+
+void TaskStatusModel::finishTask(int row, double progress, const QString& result)
+{
+  if ((0 <= row) && (row < rowCount()))
+  {
+    _tasks[row].progress = progress;
+    _tasks[row].result = result;
+    widenColumn(Column::RESULT, result);
+    changeRow(row);
+  }
+}
+
+QVector<int> TaskStatusModel::flush()
+{
+  if (_firstChangedRow >= 0)
+  {
+    auto firstChangedRow = std::exchange(_firstChangedRow, -1);
+    auto lastChangedRow = std::exchange(_lastChangedRow, -1);
+    emit dataChanged(index(firstChangedRow, 0), index(lastChangedRow, Column::_COUNT - 1), { Qt::DisplayRole });
+  }
+
+  QVector<int> columns{};
+  for (int column = 0; column < Column::_COUNT; ++column)
+    if (std::exchange(_isColumnWidened[column], false))
+      columns.push_back(column);
+  return columns;
+}
+
+void TaskStatusModel::changeRow(int row) noexcept
+{
+  _firstChangedRow = _firstChangedRow < 0 ? row : std::min(_firstChangedRow, row);
+  _lastChangedRow = std::max(_lastChangedRow, row);
+}
+
+void TaskStatusModel::widenColumn(int column, const QString& text)
+{
+  if (_columnWidths[column] < text.size())
+  {
+    _columnWidths[column] = text.size();
+    _isColumnWidened[column] = true;
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef TASK_STATUS_MODEL_H
+#define TASK_STATUS_MODEL_H
+
+#include <TaskLauncher.h>
+
+#include <QtCore/QAbstractTableModel>
+#include <QtCore/QVector>
+
+#include <array>
+#include <vector>
+
+struct TaskStatus
+{
+  TaskId taskId{ 0 };
+  QString threadId{};
+  QString range{};
+  double progress{ 0 };
+  QString result{};
+};
+
+// Task statuses stored by row in a flat array. Changes are collected and reported by flush as a single dataChanged range.
+class TaskStatusModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+public:
+  // clang-format off
+  enum Column : int { ID, THREAD_ID, INFO, PROGRESS, RESULT, _COUNT };
+  // clang-format on
+
+public:
+  explicit TaskStatusModel(QObject* parent = nullptr);
+
+  int rowCount(const QModelIndex& parent = QModelIndex{}) const override;
+  int columnCount(const QModelIndex& parent = QModelIndex{}) const override;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+  void reset(int rowCount);
+  void startTask(int row, TaskId taskId, const QString& threadId, const QString& range);
+  void setProgress(int row, double progress);
+  void finishTask(int row, double progress, const QString& result);
+  // Emits dataChanged for the rows changed since the last flush, returns the columns whose text got wider
+  QVector<int> flush();
+
+private:
+  void changeRow(int row) noexcept;
+  void widenColumn(int column, const QString& text);
+
+private:
+  std::vector<TaskStatus> _tasks;
+  int _firstChangedRow;
+  int _lastChangedRow;
+  std::array<int, _COUNT> _columnWidths;
+  std::array<bool, _COUNT> _isColumnWidened;
+};
+
+#endif // TASK_STATUS_MODEL_H
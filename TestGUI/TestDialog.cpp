@@ -1,10 +1,15 @@
 #include "TestDialog.h"
 #include "ui_TestDialog.h"
 
+#include "TaskStatusModel.h"
+
 #include <ArraySort.h>
 
+#include <algorithm>
+
 #include <QtGui/QScreen>
-#include <QtGui/QStandardItemModel>
+
+#include <QtCore/QTimer>
 
 #include <QtWidgets/QMessageBox>
 #include <QtWidgets/QStatusBar>
@@ -32,12 +37,6 @@ public:
     return type;
   }
 
-  static int taskProgressEventType()
-  {
-    static auto type = QEvent::registerEventType();
-    return type;
-  }
-
   static int taskEndEventType()
   {
     static auto type = QEvent::registerEventType();
@@ -51,11 +50,6 @@ public:
     QCoreApplication::postEvent(reseiver, new TaskEvent{ taskStartEventType(), taskId, QVariantList{ thrdId, taskRange } });
   }
 
-  static void taskProgressEventFn(QObject* reseiver, TaskId taskId, SortTaskProgress taskProgress)
-  {
-    QCoreApplication::postEvent(reseiver, new TaskEvent{ taskProgressEventType(), taskId, taskProgress });
-  }
-
   static void taskEndEventFn(QObject* reseiver, TaskId taskId, const SortTaskResult& taskResult)
   {
     QCoreApplication::postEvent(reseiver, new TaskEvent{ taskEndEventType(), taskId, QVariant::fromValue(taskResult) });
@@ -77,15 +71,12 @@ private:
   QVariant _taskInfo;
 };
 
-// clang-format off
-struct TaskStatusCols { enum : int { ID, THREAD_ID, INFO, PROGRESS, RESULT, _COUNT }; };
-// clang-format on
-
 TestDialog::TestDialog(QWidget* parent)
   : QDialog(parent)
   , _ui(new Ui::TestDialog)
-  , _data(new ArraySort{ std::bind(TaskEvent::taskStartEventFn, this, _1, _2, _3, _4), std::bind(TaskEvent::taskProgressEventFn, this, _1, _2),
-      std::bind(TaskEvent::taskEndEventFn, this, _1, _2) })
+  , _data(new ArraySort{ std::bind(TaskEvent::taskStartEventFn, this, _1, _2, _3, _4), std::bind(TaskEvent::taskEndEventFn, this, _1, _2) })
+  , _taskStatusModel{ nullptr }
+  , _runningRows{}
 {
   _ui->setupUi(this);
 
@@ -95,16 +86,9 @@ TestDialog::TestDialog(QWidget* parent)
     statusBar->showMessage(QString("Thread pool size: %1").arg(_data->threadCount()));
   }
   {
-    auto taskStatusModel = new QStandardItemModel{ this };
-
-    taskStatusModel->setColumnCount(TaskStatusCols::_COUNT);
-    taskStatusModel->setHeaderData(TaskStatusCols::ID, Qt::Horizontal, "Id");
-    taskStatusModel->setHeaderData(TaskStatusCols::THREAD_ID, Qt::Horizontal, "Thread Id");
-    taskStatusModel->setHeaderData(TaskStatusCols::INFO, Qt::Horizontal, "Array Index Range");
-    taskStatusModel->setHeaderData(TaskStatusCols::PROGRESS, Qt::Horizontal, "Progress");
-    taskStatusModel->setHeaderData(TaskStatusCols::RESULT, Qt::Horizontal, "Result");
-
-    _ui->taskStatusTable->setModel(taskStatusModel);
+    _taskStatusModel = new TaskStatusModel{ this };
+    _ui->taskStatusTable->setModel(_taskStatusModel);
+    _ui->taskStatusTable->resizeColumnsToContents();
   }
 
   auto minArraySize = _data->minArraySize();
@@ -127,6 +111,11 @@ TestDialog::TestDialog(QWidget* parent)
   connect(_ui->arraySizeSldr, &QSlider::valueChanged, this, &TestDialog::changeArraySize);
   connect(_ui->applyArraySizeBttn, &QPushButton::clicked, this, &TestDialog::applyArraySize);
   connect(_ui->startStopBttn, &QPushButton::toggled, this, &TestDialog::startStopSorting);
+
+  // The progress of running tasks is sampled and the table is updated at the frame rate
+  auto progressTimer = new QTimer{ this };
+  connect(progressTimer, &QTimer::timeout, this, &TestDialog::updateTaskStatus);
+  progressTimer->start(1000 / 30);
 }
 
 TestDialog::~TestDialog()
@@ -142,37 +131,14 @@ bool TestDialog::event(QEvent* event)
     auto taskEvent = static_cast<TaskEvent*>(event);
     auto taskId = taskEvent->taskId();
     auto taskInfo = taskEvent->taskInfo().toList();
-    auto threadId = taskInfo.size() ? taskInfo.front() : QVariant{};
-    auto taskRange = taskInfo.size() ? taskInfo.back() : QVariant{};
-
-    auto taskStatusModel = _ui->taskStatusTable->model();
-    auto row = _data->saveTask(taskId);
+    auto threadId = taskInfo.value(0);
+    auto taskRange = taskInfo.value(1);
 
-    taskStatusModel->insertRow(row);
-    taskStatusModel->setData(taskStatusModel->index(row, TaskStatusCols::ID), taskId);
-    taskStatusModel->setData(taskStatusModel->index(row, TaskStatusCols::THREAD_ID), threadId);
-    taskStatusModel->setData(taskStatusModel->index(row, TaskStatusCols::INFO), taskRange);
-    taskStatusModel->setData(taskStatusModel->index(row, TaskStatusCols::PROGRESS), 0.0);
-    taskStatusModel->setData(taskStatusModel->index(row, TaskStatusCols::RESULT), "");
-
-    _ui->taskStatusTable->resizeColumnsToContents();
-
-    return true;
-  }
-  else if (event->type() == TaskEvent::taskProgressEventType())
-  {
-    auto taskEvent = static_cast<TaskEvent*>(event);
-    auto taskId = taskEvent->taskId();
-    if (_data->isTaskSaved(taskId))
+    if (_data->isBatchTask(taskId))
     {
-      auto taskStatusModel = _ui->taskStatusTable->model();
-      auto row = _data->taskIndex(taskId);
-      if (row < taskStatusModel->rowCount())
-      {
-        taskStatusModel->setData(taskStatusModel->index(row, TaskStatusCols::PROGRESS), taskEvent->taskInfo());
-
-        _ui->taskStatusTable->resizeColumnsToContents();
-      }
+      auto row = static_cast<int>(_data->taskIndex(taskId));
+      _runningRows.push_back(row);
+      _taskStatusModel->startTask(row, taskId, threadId.toString(), taskRange.toString());
     }
 
     return true;
@@ -182,26 +148,20 @@ bool TestDialog::event(QEvent* event)
     auto taskEvent = static_cast<TaskEvent*>(event);
     auto taskId = taskEvent->taskId();
 
-    if (_data->isTaskSaved(taskId))
+    if (_data->isBatchTask(taskId))
     {
-      auto taskStatusModel = _ui->taskStatusTable->model();
-      auto row = _data->finishTask(taskId);
-      if (row < taskStatusModel->rowCount())
+      auto row = static_cast<int>(_data->taskIndex(taskId));
+      _runningRows.erase(std::remove(_runningRows.begin(), _runningRows.end(), row), _runningRows.end());
+      try
+      {
+        auto taskResult = taskEvent->taskInfo().value<SortTaskResult>().get();
+        _taskStatusModel->finishTask(row, 1.0, QString::fromStdString(taskResult));
+      }
+      catch (const std::runtime_error& e)
       {
-        try
-        {
-          auto taskResult = taskEvent->taskInfo().value<SortTaskResult>().get();
-          taskStatusModel->setData(taskStatusModel->index(row, TaskStatusCols::PROGRESS), 1.0);
-          taskStatusModel->setData(taskStatusModel->index(row, TaskStatusCols::RESULT), QString::fromStdString(taskResult));
-        }
-        catch (const std::runtime_error& e)
-        {
-          taskStatusModel->setData(taskStatusModel->index(row, TaskStatusCols::RESULT), e.what());
-        }
-
-        _ui->taskStatusTable->resizeColumnsToContents();
+        _taskStatusModel->finishTask(row, _data->taskProgress(row), e.what());
       }
-      if (!_data->areAllTasksFinished())
+      if (_data->areAllTasksFinished())
       {
         QSignalBlocker signalBlocker{ _ui->startStopBttn };
         _ui->startStopBttn->setChecked(false);
@@ -214,6 +174,15 @@ bool TestDialog::event(QEvent* event)
   return QDialog::event(event);
 }
 
+void TestDialog::updateTaskStatus()
+{
+  for (auto row : _runningRows)
+    _taskStatusModel->setProgress(row, _data->taskProgress(row));
+  // Columns are measured again only if their content got wider
+  for (auto column : _taskStatusModel->flush())
+    _ui->taskStatusTable->resizeColumnToContents(column);
+}
+
 void TestDialog::changeArraySize()
 {
   _ui->arraySizeEdit->setProperty(PROP_ARR_SZ,
@@ -235,10 +204,10 @@ void TestDialog::startStopSorting(bool start)
 {
   if (start)
   {
-    auto taskStatusModel = _ui->taskStatusTable->model();
     _data->interrupt();
-    taskStatusModel->removeRows(0, taskStatusModel->rowCount());
+    _runningRows.clear();
     _data->sort();
+    _taskStatusModel->reset(static_cast<int>(_data->taskCount()));
   }
   else
     _data->interrupt();
@@ -3,12 +3,15 @@
 
 #include <QtWidgets/QDialog>
 
+#include <vector>
+
 namespace Ui
 {
 class TestDialog;
 }
 
 class ArraySort;
+class TaskStatusModel;
 
 class TestDialog : public QDialog
 {
@@ -24,10 +27,13 @@ public Q_SLOTS:
   void changeArraySize();
   void applyArraySize();
   void startStopSorting(bool start);
+  void updateTaskStatus();
 
 private:
   Ui::TestDialog* _ui;
   ArraySort* _data;
+  TaskStatusModel* _taskStatusModel;
+  std::vector<int> _runningRows;
 };
 
 #endif // TESTDIALOG_H
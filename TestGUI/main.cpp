@@ -1,17 +1,35 @@
 #include "TestDialog.h"
 
+#include <TaskTracer.h>
+
 #include <QtWidgets/QApplication>
 
+#include <fstream>
+
 int main(int argc, char* argv[])
 {
   if (getenv("QTDIR"))
     QApplication::addLibraryPath(QString() + getenv("QTDIR") + "/plugins");
 
-  QApplication a{ argc, argv };
-  TestDialog dialog{};
+  // The execution trace is dumped into the file given by the environment variable
+  auto traceFileName = getenv("TASKQUEUE_TRACE");
+  if (traceFileName)
+    TaskTracer::start();
+
+  {
+    QApplication a{ argc, argv };
+    TestDialog dialog{};
+
+    dialog.show();
+    a.exec();
+  }
 
-  dialog.show();
-  a.exec();
+  if (traceFileName)
+  {
+    TaskTracer::stop();
+    std::ofstream traceFile{ traceFileName };
+    TaskTracer::dump(traceFile);
+  }
 
   return 0;
 }